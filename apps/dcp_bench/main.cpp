@@ -0,0 +1,247 @@
+#include <algorithm>
+#include <chrono>
+#include <dcp/dcp.hpp>
+#include <executor/executor.hpp>
+#include <fstream>
+#include <functional>
+#include <haze_model/haze_model.hpp>
+#include <image_loader/image_loader.hpp>
+#include <iostream>
+#include <opencv2/core.hpp>
+#include <opencv2/imgcodecs.hpp>
+#include <simd/simd.hpp>
+#include <sstream>
+#include <string>
+#include <vector>
+
+struct Arguments {
+  std::vector<cv::Size> resolutions{{640, 480},   {1280, 720},  {1920, 1080},
+                                    {3840, 2160}, {7680, 4320}};
+  std::vector<int> patch_sizes{3, 7, 15, 31};
+  int repeat = 5;
+  std::string output;
+  std::string isa;
+};
+
+struct Measurement {
+  std::string stage;
+  cv::Size size;
+  int patch_size = 0;
+  std::vector<double> times_ms;
+};
+
+static std::vector<std::string> Split(const std::string& str) {
+  std::vector<std::string> result;
+  std::stringstream stream(str);
+  std::string item;
+  while (std::getline(stream, item, ',')) result.push_back(item);
+  return result;
+}
+
+Arguments ParseArgs(int argc, char* argv[]) {
+  std::string help_message(
+      "dcp_bench [--resolutions <WxH,...>] [--patches <p,...>] "
+      "[--repeat <n>] [--output <file.json>] "
+      "[--isa <generic|sse4.2|avx2|avx512>]\n\n"
+      "Optional arguments:\n"
+      "\t--resolutions	image sizes, default 640x480,1280x720,1920x1080,"
+      "3840x2160,7680x4320\n"
+      "\t--patches    	dark channel patch sizes, default 3,7,15,31\n"
+      "\t--repeat     	timed runs per measurement, default 5\n"
+      "\t--output     	file for the JSON report, default stdout\n"
+      "\t--isa        	instruction set of the kernels, default the best one "
+      "the CPU supports\n");
+  Arguments args;
+  try {
+    for (int i = 1; i < argc; ++i) {
+      std::string arg(argv[i]);
+      if (i + 1 == argc) throw std::runtime_error(help_message);
+      std::string value(argv[++i]);
+      if (arg == "--resolutions") {
+        args.resolutions.clear();
+        for (const auto& item : Split(value)) {
+          size_t x = item.find('x');
+          if (x == std::string::npos) throw std::runtime_error(help_message);
+          args.resolutions.emplace_back(std::stoi(item.substr(0, x)),
+                                        std::stoi(item.substr(x + 1)));
+        }
+      } else if (arg == "--patches") {
+        args.patch_sizes.clear();
+        for (const auto& item : Split(value))
+          args.patch_sizes.push_back(std::stoi(item));
+      } else if (arg == "--repeat") {
+        args.repeat = std::stoi(value);
+      } else if (arg == "--output") {
+        args.output = value;
+      } else if (arg == "--isa") {
+        args.isa = value;
+      } else {
+        throw std::runtime_error(help_message);
+      }
+    }
+  } catch (const std::logic_error&) {
+    throw std::runtime_error(help_message);
+  }
+  if (args.repeat < 1 || args.resolutions.empty() || args.patch_sizes.empty())
+    throw std::runtime_error(help_message);
+  for (int patch_size : args.patch_sizes)
+    if (patch_size < 1 || patch_size % 2 == 0)
+      throw std::runtime_error(help_message);
+  return args;
+}
+
+static Measurement Measure(const std::string& stage, const cv::Size& size,
+                           const int patch_size, const int repeat,
+                           const std::function<void()>& run) {
+  Measurement measurement{stage, size, patch_size, {}};
+  run();  // warm-up
+  for (int i = 0; i < repeat; ++i) {
+    auto start = std::chrono::steady_clock::now();
+    run();
+    auto finish = std::chrono::steady_clock::now();
+    measurement.times_ms.push_back(
+        std::chrono::duration<double, std::milli>(finish - start).count());
+  }
+  return measurement;
+}
+
+static std::string ToJson(const std::vector<Measurement>& measurements,
+                          const int repeat) {
+  std::ostringstream json;
+  json << "{\n  \"repeat\": " << repeat << ",\n  \"isa\": \""
+       << simd::IsaName(simd::ActiveIsa()) << "\",\n  \"results\": [";
+  for (size_t i = 0; i < measurements.size(); ++i) {
+    const auto& m = measurements[i];
+    std::vector<double> times = m.times_ms;
+    std::sort(times.begin(), times.end());
+    double mean = 0;
+    for (double t : times) mean += t;
+    mean /= times.size();
+    json << (i == 0 ? "\n" : ",\n") << "    {\"stage\": \"" << m.stage
+         << "\", \"width\": " << m.size.width
+         << ", \"height\": " << m.size.height
+         << ", \"patch_size\": " << m.patch_size
+         << ", \"min_ms\": " << times.front()
+         << ", \"median_ms\": " << times[times.size() / 2]
+         << ", \"mean_ms\": " << mean << ", \"max_ms\": " << times.back()
+         << "}";
+  }
+  json << "\n  ]\n}\n";
+  return json.str();
+}
+
+static fs::path MakeTempDir(const std::string& name) {
+  fs::path dir = fs::temp_directory_path() / name;
+  fs::remove_all(dir);
+  fs::create_directories(dir);
+  return dir;
+}
+
+static std::vector<Measurement> BenchResolution(const cv::Size& size,
+                                                const Arguments& args) {
+  std::vector<Measurement> result;
+  cv::RNG rng(42);
+  cv::Mat image(size, CV_64FC3);
+  rng.fill(image, cv::RNG::UNIFORM, 0.0, 1.0);
+  cv::Mat depth_map(size, CV_64FC1);
+  rng.fill(depth_map, cv::RNG::UNIFORM, 0.3, 1.0);
+
+  for (int patch_size : args.patch_sizes) {
+    result.push_back(Measure("DarkChannel", size, patch_size, args.repeat,
+                             [&]() { dcp::DarkChannel(image, patch_size); }));
+    result.push_back(Measure("EstimateAtmospericLight", size, patch_size,
+                             args.repeat, [&]() {
+                               dcp::EstimateAtmospericLight(image, patch_size);
+                             }));
+    result.push_back(Measure("EstimateAtmospericLightHistogram", size,
+                             patch_size, args.repeat, [&]() {
+                               dcp::EstimateAtmospericLight(
+                                   image, patch_size, 1e-3,
+                                   dcp::DARK_CHANNEL_HISTOGRAM);
+                             }));
+    cv::Mat atmospheric_light =
+        dcp::EstimateAtmospericLight(image, patch_size);
+    result.push_back(Measure("EstimateTransmission", size, patch_size,
+                             args.repeat, [&]() {
+                               dcp::EstimateTransmission(
+                                   image, atmospheric_light, patch_size);
+                             }));
+  }
+
+  result.push_back(
+      Measure("EstimateAtmospericLightQuadTree", size, 0, args.repeat,
+              [&]() { dcp::EstimateAtmospericLightQuadTree(image); }));
+  cv::Mat atmospheric_light = dcp::EstimateAtmospericLight(image, 15);
+  cv::Mat transmission = dcp::EstimateTransmission(image, atmospheric_light, 15);
+  result.push_back(Measure("SoftMatting", size, 51, args.repeat, [&]() {
+    dcp::SoftMatting(transmission, image, 51, 0.01);
+  }));
+  haze::HazeModel model(transmission, atmospheric_light);
+  cv::Mat output(size, CV_64FC3);
+  result.push_back(Measure("RecoverImage", size, 0, args.repeat,
+                           [&]() { model.RecoverImage(output, image); }));
+  result.push_back(Measure("AugmentImage", size, 0, args.repeat,
+                           [&]() { model.AugmentImage(output, image); }));
+  cv::Mat created_transmission(size, CV_64FC1);
+  result.push_back(Measure("CreateTransmission", size, 0, args.repeat, [&]() {
+    haze::CreateTransmission(created_transmission, depth_map, 2.0);
+  }));
+  cv::Mat depth_map_16u;
+  depth_map.convertTo(depth_map_16u, CV_16UC1, 65535.0);
+  result.push_back(
+      Measure("CreateTransmission16U", size, 0, args.repeat, [&]() {
+        haze::CreateTransmission(created_transmission, depth_map_16u, 2.0);
+      }));
+
+  fs::path input_dir = MakeTempDir("dcp_bench_input");
+  cv::Mat ui_image;
+  image.convertTo(ui_image, CV_8UC3, 255.);
+  load::PathWrapper image_path((input_dir / "image.png").u8string());
+  cv::imwrite(image_path.ToString(), ui_image);
+  result.push_back(Measure("LoadImg", size, 0, args.repeat,
+                           [&]() { load::LoadImg(image_path); }));
+  std::vector<std::string> input_pathes{input_dir.u8string()};
+  // every run needs an empty result dir, all of them are made before timing
+  std::vector<std::string> output_dirs;
+  for (int k = 0; k <= args.repeat; ++k)
+    output_dirs.push_back(
+        MakeTempDir("dcp_bench_output_" + std::to_string(k)).u8string());
+  size_t run = 0;
+  result.push_back(Measure("Produce", size, 15, args.repeat, [&]() {
+    exec::Produce(input_pathes, output_dirs[run++]);
+  }));
+  fs::remove_all(input_dir);
+  for (const auto& dir : output_dirs) fs::remove_all(dir);
+  return result;
+}
+
+int main(int argc, char* argv[]) {
+  Arguments args;
+  try {
+    args = ParseArgs(argc, argv);
+  } catch (const std::runtime_error& err) {
+    std::cerr << err.what() << std::endl;
+    return 1;
+  }
+  try {
+    if (!args.isa.empty()) simd::SetIsa(simd::ParseIsa(args.isa));
+    std::vector<Measurement> measurements;
+    for (const auto& size : args.resolutions) {
+      std::cerr << "benchmarking " << size.width << "x" << size.height
+                << std::endl;
+      auto resolution_measurements = BenchResolution(size, args);
+      measurements.insert(measurements.end(), resolution_measurements.begin(),
+                          resolution_measurements.end());
+    }
+    std::string json = ToJson(measurements, args.repeat);
+    if (args.output.empty()) {
+      std::cout << json;
+    } else {
+      std::ofstream file(args.output);
+      file << json;
+    }
+  } catch (const std::exception& err) {
+    std::cerr << err.what() << std::endl;
+    return 1;
+  }
+}
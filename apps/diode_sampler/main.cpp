@@ -0,0 +1,71 @@
+#include <diode/diode.hpp>
+#include <iostream>
+#include <string>
+#include <vector>
+
+struct Arguments {
+  std::string input_dir;
+  std::string output_dir;
+  size_t num_of_samples = 0;
+  int jobs = 1;
+  bool augment = false;
+};
+
+Arguments ParseArgs(int argc, char* argv[]) {
+  std::string help_message(
+      "diode_sampler [--jobs <n>] [--augment] <outdoor_input_dir> "
+      "<output_dir> <num_of_samples>\n\n"
+      "Positional arguments:\n"
+      "\toutdoor_input_dir	DIODE outdoor dir\n"
+      "\toutput_dir   	empty output dir\n"
+      "\tnum_of_samples	number of images to take\n\n"
+      "Optional arguments:\n"
+      "\t--jobs       	number of samples processed in parallel, default 1\n"
+      "\t--augment    	write hazy images made with float depth instead of "
+      "images/ and maps/ dirs\n");
+  Arguments args;
+  std::vector<std::string> pathes;
+  try {
+    for (int i = 1; i < argc; ++i) {
+      std::string arg(argv[i]);
+      if (arg == "--augment") {
+        args.augment = true;
+      } else if (arg == "--jobs") {
+        if (i + 1 == argc) throw std::runtime_error(help_message);
+        args.jobs = std::stoi(argv[++i]);
+      } else {
+        pathes.push_back(arg);
+      }
+    }
+    if (pathes.size() != 3) throw std::runtime_error(help_message);
+    long long num_of_samples = std::stoll(pathes[2]);
+    if (num_of_samples < 0 || args.jobs < 1)
+      throw std::runtime_error(help_message);
+    args.num_of_samples = static_cast<size_t>(num_of_samples);
+  } catch (const std::logic_error&) {
+    throw std::runtime_error(help_message);
+  }
+  args.input_dir = pathes[0];
+  args.output_dir = pathes[1];
+  return args;
+}
+
+int main(int argc, char* argv[]) {
+  Arguments args;
+  try {
+    args = ParseArgs(argc, argv);
+  } catch (const std::runtime_error& err) {
+    std::cerr << err.what() << std::endl;
+    return 1;
+  }
+  try {
+    auto samples = diode::FindSamples(args.input_dir, args.num_of_samples);
+    if (args.augment)
+      diode::Augment(samples, args.output_dir, args.jobs);
+    else
+      diode::Export(samples, args.output_dir, args.jobs);
+  } catch (const std::exception& err) {
+    std::cerr << err.what() << std::endl;
+    return 1;
+  }
+}
@@ -0,0 +1,98 @@
+#include <algorithm>
+#include <image_loader/image_loader.hpp>
+#include <iostream>
+#include <metrics/metrics.hpp>
+#include <opencv2/core.hpp>
+#include <opencv2/imgcodecs.hpp>
+#include <parallel/parallel.hpp>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct Arguments {
+  std::string lhs_dir;
+  std::string rhs_dir;
+  int jobs =
+      static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+};
+
+Arguments ParseArgs(int argc, char* argv[]) {
+  std::string help_message(
+      "haze_compare [--jobs <n>] <lhs_dir> <rhs_dir>\n\n"
+      "Positional arguments:\n"
+      "\tlhs_dir      	images to score, searched recursively\n"
+      "\trhs_dir      	reference images paired with lhs ones by file name\n\n"
+      "Optional arguments:\n"
+      "\t--jobs       	number of images compared in parallel, default is the "
+      "number of cores\n");
+  Arguments args;
+  std::vector<std::string> pathes;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg(argv[i]);
+    if (arg == "--jobs") {
+      if (i + 1 == argc) throw std::runtime_error(help_message);
+      try {
+        args.jobs = std::stoi(argv[++i]);
+      } catch (const std::exception&) {
+        throw std::runtime_error(help_message);
+      }
+      if (args.jobs < 1) throw std::runtime_error(help_message);
+    } else {
+      pathes.push_back(arg);
+    }
+  }
+  if (pathes.size() != 2) throw std::runtime_error(help_message);
+  args.lhs_dir = pathes[0];
+  args.rhs_dir = pathes[1];
+  return args;
+}
+
+static cv::Mat Decode(const std::filesystem::path& path) {
+  cv::Mat result = cv::imread(path.u8string(), cv::IMREAD_COLOR);
+  if (result.empty()) result = load::LoadImgUTF8(load::PathWrapper(path));
+  if (result.empty())
+    throw std::runtime_error("Decode(...): cannot read " + path.u8string());
+  return result;
+}
+
+int main(int argc, char* argv[]) {
+  Arguments args;
+  try {
+    args = ParseArgs(argc, argv);
+  } catch (const std::runtime_error& err) {
+    std::cerr << err.what() << std::endl;
+    return 1;
+  }
+  try {
+    auto pairs = metrics::PairByName(args.lhs_dir, args.rhs_dir);
+    if (pairs.empty()) throw std::runtime_error("no images to compare");
+    // every worker keeps only its current pair decoded
+    std::vector<metrics::Scores> scores(pairs.size());
+    parallel::ForEach(
+        static_cast<int>(pairs.size()), args.jobs, [&](const int i) {
+          try {
+            scores[i] = metrics::Compare(Decode(pairs[i].first),
+                                         Decode(pairs[i].second), 255);
+          } catch (const std::exception& ex) {
+            throw std::runtime_error(pairs[i].first.filename().u8string() +
+                                     ": " + ex.what());
+          }
+        });
+
+    metrics::Scores sum;
+    for (size_t i = 0; i < pairs.size(); ++i) {
+      std::cout << pairs[i].first.filename().u8string() << " : "
+                << scores[i].ssim << " " << scores[i].mse << " "
+                << scores[i].psnr << "\n";
+      sum.ssim += scores[i].ssim;
+      sum.mse += scores[i].mse;
+      sum.psnr += scores[i].psnr;
+    }
+    double n = static_cast<double>(pairs.size());
+    std::cout << "Average measures: ssim " << sum.ssim / n << " ,mse "
+              << sum.mse / n << " ,psnr " << sum.psnr / n << std::endl;
+  } catch (const std::exception& err) {
+    std::cerr << err.what() << std::endl;
+    return 1;
+  }
+}
@@ -1,23 +1,185 @@
+#include <algorithm>
+#include <band/band.hpp>
 #include <executor/executor.hpp>
+#include <fstream>
 #include <iostream>
+#include <simd/simd.hpp>
+#include <stats/stats.hpp>
+#include <trace/trace.hpp>
 
-std::vector<std::string> ParseArgs(int argc, char* argv[]) {
+struct Arguments {
+  std::vector<std::string> pathes;
+  exec::ProduceOptions options;
+  bool stats = false;
+  std::string stats_path;
+  std::string trace_path;
+  // empty means the one detected by CPUID
+  std::string isa;
+  // size of the raw input dehazed out of core, empty for directories
+  cv::Size out_of_core;
+};
+
+Arguments ParseArgs(int argc, char* argv[]) {
   std::string help_message(
-      "HazeMachine <output_dir> <input_dirs> [1..2]\n\n"
+      "HazeMachine [--scale <factor>] [--jobs <n>] [--stats[=<file.json>]] "
+      "[--trace <file.json>] [--eval <gt_dir>] [--no-write] [--horizon] "
+      "[--format <png|jpeg|ppm|webp|container>] "
+      "[--container-codec <raw|png|jpeg|ppm|webp>] [--png-level <0..9>] "
+      "[--jpeg-quality <0..100>] [--webp-quality <1..101>] "
+      "[--encoder-threads <n>] [--diagnostics] [--planes <image|f16|f32>] "
+      "[--isa <generic|sse4.2|avx2|avx512>] "
+      "[--light <top|histogram|quadtree>] "
+      "[--out-of-core <WxH>] "
+      "<output_dir> <input_dirs> [1..2]\n\n"
       "Positional arguments:\n"
-      "\toutput_dir   	empty output dir\n"
+      "\toutput_dir   	empty output dir, omitted with --no-write\n"
       "\tinput_dirs   	gets one image directory to dehaze or two to augment"
-      "[nargs=1..2] \n");
-  if (argc <= 2 || argc > 4) throw std::runtime_error(help_message);
-  std::vector<std::string> args;
+      "[nargs=1..2] \n\n"
+      "Optional arguments:\n"
+      "\t--scale      	estimate atmospheric light and transmission on the "
+      "image downsampled by the factor (e.g. 4 or 8), default 1\n"
+      "\t--jobs       	number of images processed in parallel, default 1\n"
+      "\t--stats      	print per-stage timings and allocations, or dump them "
+      "as JSON to the given file\n"
+      "\t--trace      	write Chrome Trace Event JSON with a span per stage, "
+      "image and thread\n"
+      "\t--eval       	score results against the images of the same name from "
+      "the dir before they are quantized and print ssim, mse and psnr\n"
+      "\t--no-write   	don't write results, useful with --eval\n"
+      "\t--horizon    	augment one dir of horizon photos with depth generated "
+      "from the sky\n"
+      "\t--format     	output format, default is the input one; container "
+      "packs all results into results.pack\n"
+      "\t--container-codec	codec of container records, default raw pixels\n"
+      "\t--png-level  	PNG compression level, default 1\n"
+      "\t--jpeg-quality	JPEG quality, default 95\n"
+      "\t--webp-quality	WebP quality, above 100 is lossless, default 100\n"
+      "\t--encoder-threads	threads converting and writing results while "
+      "workers process next images, default 0 (workers write themselves)\n"
+      "\t--diagnostics	also write dark channel (_dc) and transmission (_tr) "
+      "of dehazed images\n"
+      "\t--planes     	write the diagnostics as 8-bit images or float16/"
+      "float32 .npy arrays (raw .npy-named records in a container), used "
+      "with --diagnostics\n"
+      "\t--isa        	instruction set of the kernels instead of the best one "
+      "the CPU supports, for benchmarking\n"
+      "\t--light      	how the brightest dark channel pixels are found: a heap "
+      "over all pixels (top, default) or a histogram of the dark channel "
+      "and a gather of the pixels above its threshold; quadtree picks the "
+      "light in the flattest bright region found by splitting the image in "
+      "quadrants\n"
+      "\t--out-of-core	dehaze one raw 8-bit BGR file of the size in two "
+      "streaming passes, with --jobs bands in parallel; output_dir and "
+      "input_dirs are the result and input files then, options of the "
+      "output, --eval, --horizon and --stats=<file> can't be used with it\n");
+  // options of directory runs that out-of-core dehazing doesn't support
+  const std::vector<std::string> directory_options{
+      "--eval", "--no-write", "--horizon", "--format", "--diagnostics",
+      "--planes", "--container-codec", "--png-level", "--jpeg-quality",
+      "--webp-quality", "--encoder-threads"};
+  bool directory_run = false;
+  Arguments args;
   for (int i = 1; i < argc; ++i) {
-    args.emplace_back(argv[i]);
+    std::string arg(argv[i]);
+    if (std::find(directory_options.begin(), directory_options.end(), arg) !=
+            directory_options.end() ||
+        arg.rfind("--stats=", 0) == 0)
+      directory_run = true;
+    if (arg == "--scale" || arg == "--jobs" || arg == "--trace" ||
+        arg == "--eval" || arg == "--format" || arg == "--container-codec" ||
+        arg == "--png-level" || arg == "--jpeg-quality" ||
+        arg == "--webp-quality" || arg == "--encoder-threads" ||
+        arg == "--planes" || arg == "--isa" || arg == "--light" ||
+        arg == "--out-of-core") {
+      if (i + 1 == argc) throw std::runtime_error(help_message);
+      std::string value(argv[++i]);
+      if (arg == "--trace") {
+        args.trace_path = value;
+        continue;
+      }
+      if (arg == "--isa") {
+        args.isa = value;
+        continue;
+      }
+      if (arg == "--out-of-core") {
+        size_t x = value.find('x');
+        try {
+          if (x == std::string::npos) throw std::runtime_error(help_message);
+          args.out_of_core = cv::Size(std::stoi(value.substr(0, x)),
+                                      std::stoi(value.substr(x + 1)));
+        } catch (const std::exception&) {
+          throw std::runtime_error(help_message);
+        }
+        if (args.out_of_core.empty()) throw std::runtime_error(help_message);
+        continue;
+      }
+      if (arg == "--eval") {
+        args.options.ground_truth_path = value;
+        continue;
+      }
+      auto& encoding = args.options.encoding;
+      int number = 0;
+      try {
+        if (arg == "--format") {
+          encoding.format = encode::ParseFormat(value);
+          continue;
+        }
+        if (arg == "--light") {
+          args.options.parameters.atmospheric_light_method =
+              dcp::ParseAtmosphericLightMethod(value);
+          continue;
+        }
+        if (arg == "--planes") {
+          encoding.plane_format = encode::ParsePlaneFormat(value);
+          continue;
+        }
+        if (arg == "--container-codec") {
+          encoding.container_codec = encode::ParseFormat(value);
+          continue;
+        }
+        number = std::stoi(value);
+      } catch (const std::exception&) {
+        throw std::runtime_error(help_message);
+      }
+      if (arg == "--png-level")
+        encoding.png_compression = number;
+      else if (arg == "--jpeg-quality")
+        encoding.jpeg_quality = number;
+      else if (arg == "--webp-quality")
+        encoding.webp_quality = number;
+      else if (arg == "--encoder-threads")
+        encoding.threads = number;
+      else if (number < 1)
+        throw std::runtime_error(help_message);
+      else if (arg == "--scale")
+        args.options.parameters.scale = number;
+      else
+        args.options.jobs = number;
+    } else if (arg == "--diagnostics") {
+      args.options.diagnostics = true;
+    } else if (arg == "--horizon") {
+      args.options.horizon_depth = true;
+    } else if (arg == "--no-write") {
+      args.options.write_outputs = false;
+    } else if (arg == "--stats") {
+      args.stats = true;
+    } else if (arg.rfind("--stats=", 0) == 0) {
+      args.stats = true;
+      args.stats_path = arg.substr(std::string("--stats=").size());
+    } else {
+      args.pathes.push_back(arg);
+    }
   }
+  if (!args.options.write_outputs) args.pathes.insert(args.pathes.begin(), "");
+  if (args.pathes.size() < 2 || args.pathes.size() > 3)
+    throw std::runtime_error(help_message);
+  if (!args.out_of_core.empty() && (args.pathes.size() != 2 || directory_run))
+    throw std::runtime_error(help_message);
   return args;
 }
 
 int main(int argc, char* argv[]) {
-  std::vector<std::string> args;
+  Arguments args;
   try {
     args = ParseArgs(argc, argv);
   } catch (const std::runtime_error& err) {
@@ -25,10 +187,42 @@ int main(int argc, char* argv[]) {
     return 1;
   }
   try {
-    auto output = args.front();
+    auto output = args.pathes.front();
     std::vector<std::string> input;
-    for (size_t i = 1; i < args.size(); ++i) input.push_back(args[i]);
-    exec::Produce(input, output);
+    for (size_t i = 1; i < args.pathes.size(); ++i)
+      input.push_back(args.pathes[i]);
+    if (!args.isa.empty()) simd::SetIsa(simd::ParseIsa(args.isa));
+    stats::Enable(args.stats);
+    if (!args.trace_path.empty()) trace::Start();
+    std::vector<exec::ImageScores> scores;
+    if (args.out_of_core.empty()) {
+      scores = exec::Produce(input, output, args.options);
+    } else {
+      band::RawSource source(input.front(), args.out_of_core);
+      band::RawSink sink(output, args.out_of_core);
+      band::Dehaze(source, sink, args.options.parameters, 64,
+                   args.options.jobs);
+    }
+    trace::Stop();
+    if (!args.trace_path.empty()) trace::Write(args.trace_path);
+    if (!scores.empty()) {
+      metrics::Scores sum;
+      for (const auto& image : scores) {
+        std::cout << image.name << " : " << image.scores.ssim << " "
+                  << image.scores.mse << " " << image.scores.psnr << "\n";
+        sum.ssim += image.scores.ssim;
+        sum.mse += image.scores.mse;
+        sum.psnr += image.scores.psnr;
+      }
+      double n = static_cast<double>(scores.size());
+      std::cout << "Average measures: ssim " << sum.ssim / n << " ,mse "
+                << sum.mse / n << " ,psnr " << sum.psnr / n << std::endl;
+    }
+    if (args.stats && args.stats_path.empty()) stats::Print(std::cerr);
+    if (!args.stats_path.empty()) {
+      std::ofstream file(args.stats_path);
+      file << stats::ToJson();
+    }
   } catch (const std::exception& err) {
     std::cerr << err.what() << std::endl;
     return 1;
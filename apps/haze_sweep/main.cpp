@@ -0,0 +1,130 @@
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <sweep/sweep.hpp>
+#include <type_traits>
+#include <vector>
+
+struct Arguments {
+  std::string input_dir;
+  std::string ground_truth_dir;
+  sweep::Grid grid;
+  int jobs = 1;
+  std::string output;
+};
+
+template <typename T>
+static std::vector<T> SplitValues(const std::string& str) {
+  std::vector<T> result;
+  std::stringstream stream(str);
+  std::string item;
+  while (std::getline(stream, item, ',')) {
+    if constexpr (std::is_same_v<T, int>)
+      result.push_back(std::stoi(item));
+    else
+      result.push_back(std::stod(item));
+  }
+  return result;
+}
+
+Arguments ParseArgs(int argc, char* argv[]) {
+  std::string help_message(
+      "haze_sweep [--patches <p,...>] [--shares <s,...>] [--omegas <w,...>] "
+      "[--matting <m,...>] [--t0 <t,...>] [--jobs <n>] [--output <file.json>] "
+      "<hazy_dir> <gt_dir>\n\n"
+      "Positional arguments:\n"
+      "\thazy_dir     	images to dehaze\n"
+      "\tgt_dir       	ground truth images with the same names\n\n"
+      "Optional arguments (every list is an axis of the grid):\n"
+      "\t--patches    	dark channel patch sizes, default 15\n"
+      "\t--shares     	brightest shares for atmospheric light, default 0.001\n"
+      "\t--omegas     	haze keeping omegas, default 0.95\n"
+      "\t--matting    	refinement patch sizes, default 51\n"
+      "\t--t0         	transmission lower bounds, default 0.1\n"
+      "\t--jobs       	number of images processed in parallel, default 1\n"
+      "\t--output     	file for the JSON report, default stdout table\n");
+  Arguments args;
+  std::vector<std::string> pathes;
+  try {
+    for (int i = 1; i < argc; ++i) {
+      std::string arg(argv[i]);
+      if (arg.rfind("--", 0) != 0) {
+        pathes.push_back(arg);
+        continue;
+      }
+      if (i + 1 == argc) throw std::runtime_error(help_message);
+      std::string value(argv[++i]);
+      if (arg == "--patches")
+        args.grid.patch_sizes = SplitValues<int>(value);
+      else if (arg == "--shares")
+        args.grid.brightest_shares = SplitValues<double>(value);
+      else if (arg == "--omegas")
+        args.grid.omegas = SplitValues<double>(value);
+      else if (arg == "--matting")
+        args.grid.matting_patch_sizes = SplitValues<int>(value);
+      else if (arg == "--t0")
+        args.grid.t0s = SplitValues<double>(value);
+      else if (arg == "--jobs")
+        args.jobs = std::stoi(value);
+      else if (arg == "--output")
+        args.output = value;
+      else
+        throw std::runtime_error(help_message);
+    }
+  } catch (const std::logic_error&) {
+    throw std::runtime_error(help_message);
+  }
+  if (pathes.size() != 2 || args.jobs < 1)
+    throw std::runtime_error(help_message);
+  args.input_dir = pathes[0];
+  args.ground_truth_dir = pathes[1];
+  return args;
+}
+
+static std::string ToJson(const std::vector<sweep::ConfigurationScores>& all) {
+  std::ostringstream json;
+  json << "{\n  \"configurations\": [";
+  for (size_t i = 0; i < all.size(); ++i) {
+    const auto& p = all[i].parameters;
+    const auto& s = all[i].mean;
+    json << (i == 0 ? "\n" : ",\n") << "    {\"patch_size\": " << p.patch_size
+         << ", \"brightest_share\": " << p.brightest_share
+         << ", \"omega\": " << p.omega
+         << ", \"matting_patch_size\": " << p.matting_patch_size
+         << ", \"t0\": " << p.t0 << ", \"ssim\": " << s.ssim
+         << ", \"mse\": " << s.mse << ", \"psnr\": " << s.psnr << "}";
+  }
+  json << "\n  ]\n}\n";
+  return json.str();
+}
+
+int main(int argc, char* argv[]) {
+  Arguments args;
+  try {
+    args = ParseArgs(argc, argv);
+  } catch (const std::runtime_error& err) {
+    std::cerr << err.what() << std::endl;
+    return 1;
+  }
+  try {
+    auto all = sweep::Sweep(args.input_dir, args.ground_truth_dir, args.grid,
+                            args.jobs);
+    if (!args.output.empty()) {
+      std::ofstream file(args.output);
+      if (!file) throw std::runtime_error("cannot open " + args.output);
+      file << ToJson(all);
+      return 0;
+    }
+    std::cout << "patch share omega matting t0 : ssim mse psnr\n";
+    for (const auto& c : all)
+      std::cout << c.parameters.patch_size << " "
+                << c.parameters.brightest_share << " " << c.parameters.omega
+                << " " << c.parameters.matting_patch_size << " "
+                << c.parameters.t0 << " : " << c.mean.ssim << " "
+                << c.mean.mse << " " << c.mean.psnr << "\n";
+  } catch (const std::exception& err) {
+    std::cerr << err.what() << std::endl;
+    return 1;
+  }
+}
@@ -0,0 +1,308 @@
+#include <algorithm>
+#include <band.hpp>
+#include <cstring>
+#include <dcp/dcp.hpp>
+#include <functional>
+#include <haze_model/haze_model.hpp>
+#include <limits>
+#include <mutex>
+#include <opencv2/core.hpp>
+#include <parallel/parallel.hpp>
+#include <simd/simd.hpp>
+#include <stats/stats.hpp>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace band {
+
+namespace {
+
+// The last rows of an image computed top to bottom from row first: Get(i)
+// computes the rows up to i by compute(k, row) and keeps capacity of them.
+class RowWindow {
+ public:
+  RowWindow(const int capacity, const int cols, const int type,
+            const int first,
+            const std::function<void(const int, cv::Mat&)>& compute)
+      : rows(capacity, cols, type),
+        compute(compute),
+        first(first),
+        next(first) {}
+  // the row stays valid until capacity more rows are computed
+  cv::Mat Get(const int i) {
+    for (; next <= i; ++next) {
+      cv::Mat row = rows.row(next % rows.rows);
+      compute(next, row);
+    }
+    if (i < next - rows.rows || i < first)
+      throw std::logic_error("RowWindow::Get(...): row left the window");
+    return rows.row(i % rows.rows);
+  }
+
+ private:
+  cv::Mat rows;
+  std::function<void(const int, cv::Mat&)> compute;
+  const int first;
+  int next;
+};
+
+// Row i of dcp::MinFilter over the rows of the window, the same operations
+// in the same order
+void MinFilterRow(RowWindow& channel_min, const int i, const int rows,
+                  const int patch_size, std::vector<double>& vertical,
+                  std::vector<double>& padded, double* dst) {
+  int radius = patch_size / 2;
+  int cols = static_cast<int>(vertical.size());
+  int first = std::max(0, i - radius);
+  int last = std::min(rows - 1, i + radius);
+  std::copy_n(channel_min.Get(first).ptr<double>(), cols, vertical.data());
+  for (int k = first + 1; k <= last; ++k)
+    simd::Min(vertical.data(), channel_min.Get(k).ptr<double>(),
+              vertical.data(), cols);
+  padded.resize(cols + 2 * radius);
+  std::fill_n(padded.begin(), radius, vertical[0]);
+  std::copy_n(vertical.begin(), cols, padded.begin() + radius);
+  std::fill_n(padded.begin() + radius + cols, radius, vertical[cols - 1]);
+  std::copy_n(padded.data(), cols, dst);
+  for (int d = 1; d <= 2 * radius; ++d)
+    simd::Min(dst, padded.data() + d, dst, cols);
+}
+
+void CheckParameters(const Source& source,
+                     const exec::DehazeParameters& parameters,
+                     const std::string& name) {
+  if (source.Type() != CV_8UC3 && source.Type() != CV_64FC3)
+    throw std::invalid_argument(name + "(...): source has incorrect type");
+  if (source.Size().width <= 0 || source.Size().height <= 0)
+    throw std::invalid_argument(name + "(...): source is empty");
+  if (parameters.patch_size < 1 || parameters.patch_size % 2 == 0)
+    throw std::invalid_argument(name + "(...): patch size is incorrect");
+  if (parameters.matting_patch_size < 1)
+    throw std::invalid_argument(name +
+                                "(...): matting patch size is incorrect");
+  if (parameters.scale != 1)
+    throw std::invalid_argument(name + "(...): scale isn't supported");
+  // the quad-tree search needs window sums over the whole image
+  if (parameters.atmospheric_light_method == dcp::QUAD_TREE)
+    throw std::invalid_argument(name +
+                                "(...): quad-tree light isn't supported");
+}
+
+}  // namespace
+
+MatSource::MatSource(const cv::Mat& image) : image(image) {
+  if (image.type() != CV_8UC3 && image.type() != CV_64FC3)
+    throw std::invalid_argument(
+        "MatSource::MatSource(...): image has incorrect type");
+}
+
+void MatSource::Read(const int i, cv::Mat& row) const {
+  image.row(i).copyTo(row);
+}
+
+MatSink::MatSink(const cv::Size& size, const int type) : result(size, type) {}
+
+void MatSink::Write(const int first, const cv::Mat& rows) {
+  rows.copyTo(result.rowRange(first, first + rows.rows));
+}
+
+RawSource::RawSource(const std::string& path, const cv::Size& size)
+    : size(size), file(path) {
+  if (size.width <= 0 || size.height <= 0 ||
+      file.Size() != static_cast<size_t>(size.width) * size.height * 3)
+    throw std::invalid_argument(
+        "RawSource::RawSource(...): file size doesn't match the image size");
+}
+
+void RawSource::Read(const int i, cv::Mat& row) const {
+  size_t row_size = static_cast<size_t>(size.width) * 3;
+  std::memcpy(row.ptr(), file.Data() + i * row_size, row_size);
+}
+
+RawSink::RawSink(const std::string& path, const cv::Size& size)
+    : size(size), file(path, std::ios::binary) {
+  if (!file) throw std::runtime_error("RawSink::RawSink(...): cannot create");
+}
+
+void RawSink::Write(const int first, const cv::Mat& rows) {
+  if (rows.type() != CV_8UC3 || rows.cols != size.width)
+    throw std::invalid_argument("RawSink::Write(...): incorrect rows");
+  std::lock_guard<std::mutex> lock(mutex);
+  file.seekp(static_cast<std::streamoff>(first) * size.width * 3);
+  std::streamsize row_size = static_cast<std::streamsize>(size.width) * 3;
+  for (int i = 0; i < rows.rows; ++i) file.write(rows.ptr<char>(i), row_size);
+  if (!file) throw std::runtime_error("RawSink::Write(...): cannot write");
+}
+
+cv::Mat EstimateAtmospericLight(const Source& source,
+                                const exec::DehazeParameters& parameters,
+                                const int jobs) {
+  CheckParameters(source, parameters, "EstimateAtmospericLight");
+  if (jobs < 1)
+    throw std::invalid_argument(
+        "EstimateAtmospericLight(...): jobs must be positive");
+  stats::ScopedTimer timer("atmospheric_light");
+  cv::Size size = source.Size();
+  int window = std::min(size.height, parameters.patch_size);
+  // one accumulator for all parts, its memory doesn't grow with jobs
+  dcp::AtmosphericLightAccumulator light(size, parameters.brightest_share);
+  std::mutex light_mutex;
+  parallel::ForEachPart(size.height, jobs, [&](const int first,
+                                                const int last) {
+    int window_first = std::max(0, first - parameters.patch_size / 2);
+    RowWindow image(
+        window, size.width, source.Type(), window_first,
+        [&](const int i, cv::Mat& row) { source.Read(i, row); });
+    RowWindow channel_min(window, size.width, CV_64FC1, window_first,
+                          [&](const int i, cv::Mat& row) {
+                            dcp::ChannelMin(image.Get(i), row);
+                          });
+    std::vector<double> vertical(size.width);
+    std::vector<double> padded;
+    std::vector<double> dark_channel(size.width);
+    // the rows are filtered against the last bound seen without the lock,
+    // which is taken only for the pixels that may be kept
+    double bound = -std::numeric_limits<double>::infinity();
+    std::vector<int> columns;
+    columns.reserve(size.width);
+    for (int i = first; i < last; ++i) {
+      MinFilterRow(channel_min, i, size.height, parameters.patch_size,
+                   vertical, padded, dark_channel.data());
+      columns.clear();
+      for (int j = 0; j < size.width; ++j)
+        if (dark_channel[j] >= bound) columns.push_back(j);
+      if (columns.empty()) continue;
+      cv::Mat row = image.Get(i);
+      std::lock_guard<std::mutex> lock(light_mutex);
+      for (int j : columns) {
+        if (!light.Accepts(i, j, dark_channel[j])) continue;
+        cv::Vec3d pixel = dcp::Pixel(row, 0, j);
+        light.Add(i, j, dark_channel[j], pixel[0] + pixel[1] + pixel[2]);
+      }
+      bound = light.Bound();
+    }
+  });
+  // second pass for the colors of the averaged pixels, row by row
+  cv::Mat row(1, size.width, source.Type());
+  int row_index = -1;
+  return light.Light([&](const int i, const int j) {
+    if (i != row_index) source.Read(row_index = i, row);
+    return dcp::Pixel(row, 0, j);
+  });
+}
+
+// Rows [first, last) of the result, the windows start at the highest row the
+// part depends on.
+static void RecoverPart(const Source& source, Sink& sink,
+                        const cv::Mat& atmospheric_light,
+                        const exec::DehazeParameters& parameters,
+                        const int band_rows, const int first,
+                        const int last) {
+  int rows = source.Size().height;
+  int cols = source.Size().width;
+  int ksize = parameters.matting_patch_size;
+  int before = ksize / 2;
+  auto border_row = [&](const int r) {
+    return cv::borderInterpolate(r - before, rows, cv::BORDER_REFLECT_101);
+  };
+  int transmission_first = rows;
+  for (int r = first; r < last + ksize - 1; ++r)
+    transmission_first = std::min(transmission_first, border_row(r));
+  int window_first =
+      std::max(0, transmission_first - parameters.patch_size / 2);
+  // the image row of an output row is reached after the windows of the
+  // transmission and of its box filter ahead of it
+  RowWindow image(std::min(rows, parameters.patch_size + ksize), cols,
+                  source.Type(), window_first,
+                  [&](const int i, cv::Mat& row) { source.Read(i, row); });
+  RowWindow normalized_min(
+      std::min(rows, parameters.patch_size), cols, CV_64FC1, window_first,
+      [&](const int i, cv::Mat& row) {
+        dcp::NormalizedChannelMin(image.Get(i), atmospheric_light, row);
+      });
+  std::vector<double> vertical(cols);
+  std::vector<double> padded;
+  RowWindow transmission(
+      std::min(rows, ksize + 1), cols, CV_64FC1, transmission_first,
+      [&](const int i, cv::Mat& row) {
+        MinFilterRow(normalized_min, i, rows, parameters.patch_size, vertical,
+                     padded, row.ptr<double>());
+        cv::Mat transmission_row = 1.0 - parameters.omega * row;
+        transmission_row.copyTo(row);
+      });
+
+  // dcp::SoftMatting, i.e. the box filter with the reflect-101 border, over
+  // rows padded on the fly
+  std::vector<int> border_cols(cols + ksize - 1);
+  for (int j = 0; j < static_cast<int>(border_cols.size()); ++j)
+    border_cols[j] = cv::borderInterpolate(j - before, cols,
+                                           cv::BORDER_REFLECT_101);
+  auto padded_row = [&](const int r, std::vector<double>& dst) {
+    const double* src = transmission.Get(border_row(r)).ptr<double>();
+    for (size_t j = 0; j < dst.size(); ++j) dst[j] = src[border_cols[j]];
+  };
+  std::vector<double> column(border_cols.size(), 0.0);
+  std::vector<double> zeros(border_cols.size(), 0.0);
+  std::vector<double> add(border_cols.size());
+  std::vector<double> sub(border_cols.size());
+  for (int k = first; k < first + ksize - 1; ++k) {
+    padded_row(k, add);
+    simd::Accumulate(column.data(), add.data(), zeros.data(), column.size());
+  }
+  double scale = 1.0 / (ksize * ksize);
+  cv::Mat matting(1, cols, CV_64FC1);
+  cv::Mat result(std::min(last - first, band_rows), cols, source.Type());
+  int band_first = first;
+  for (int i = first; i < last; ++i) {
+    padded_row(i + ksize - 1, add);
+    if (i > first) padded_row(i - 1, sub);
+    simd::Accumulate(column.data(), add.data(),
+                     i > first ? sub.data() : zeros.data(), column.size());
+    double* dst = matting.ptr<double>();
+    double sum = 0;
+    for (int d = 0; d < ksize - 1; ++d) sum += column[d];
+    for (int j = 0; j < cols; ++j) {
+      sum += column[j + ksize - 1];
+      dst[j] = sum * scale;
+      sum -= column[j];
+    }
+
+    haze::HazeModel model(matting, atmospheric_light, parameters.t0);
+    cv::Mat result_row = result.row(i - band_first);
+    model.RecoverImage(result_row, image.Get(i));
+    if (i - band_first + 1 == result.rows || i + 1 == last) {
+      sink.Write(band_first, result.rowRange(0, i - band_first + 1));
+      band_first = i + 1;
+    }
+  }
+}
+
+void RecoverImage(const Source& source, Sink& sink,
+                  const cv::Mat& atmospheric_light,
+                  const exec::DehazeParameters& parameters,
+                  const int band_rows, const int jobs) {
+  CheckParameters(source, parameters, "RecoverImage");
+  if (band_rows < 1)
+    throw std::invalid_argument(
+        "RecoverImage(...): band_rows must be positive");
+  if (jobs < 1)
+    throw std::invalid_argument("RecoverImage(...): jobs must be positive");
+  stats::ScopedTimer timer("recovery");
+  parallel::ForEachPart(source.Size().height, jobs,
+                        [&](const int first, const int last) {
+                          RecoverPart(source, sink, atmospheric_light,
+                                      parameters, band_rows, first, last);
+                        });
+}
+
+cv::Mat Dehaze(const Source& source, Sink& sink,
+               const exec::DehazeParameters& parameters, const int band_rows,
+               const int jobs) {
+  cv::Mat atmospheric_light =
+      EstimateAtmospericLight(source, parameters, jobs);
+  RecoverImage(source, sink, atmospheric_light, parameters, band_rows, jobs);
+  return atmospheric_light;
+}
+
+}  // namespace band
@@ -0,0 +1,109 @@
+#pragma once
+#ifndef BAND_HPP
+#define BAND_HPP
+
+#include <executor/executor.hpp>
+#include <fstream>
+#include <mutex>
+#include <npy/npy.hpp>
+#include <opencv2/core/mat.hpp>
+#include <string>
+
+namespace band {
+
+// Image read row by row, CV_8UC3 or CV_64FC3 in [0, 1]. Parts of the image
+// are read from several threads at once.
+class Source {
+ public:
+  virtual ~Source() = default;
+  virtual cv::Size Size() const = 0;
+  virtual int Type() const = 0;
+  // copies image row i into row, a 1 x width Mat of Type()
+  virtual void Read(const int i, cv::Mat& row) const = 0;
+};
+
+// Receives the result in bands of rows; bands of different parts of the
+// image are written from several threads at once.
+class Sink {
+ public:
+  virtual ~Sink() = default;
+  // rows of the result, the first one is image row first
+  virtual void Write(const int first, const cv::Mat& rows) = 0;
+};
+
+class MatSource : public Source {
+ public:
+  explicit MatSource(const cv::Mat& image);
+  cv::Size Size() const override { return image.size(); }
+  int Type() const override { return image.type(); }
+  void Read(const int i, cv::Mat& row) const override;
+
+ private:
+  cv::Mat image;
+};
+
+class MatSink : public Sink {
+ public:
+  MatSink(const cv::Size& size, const int type);
+  void Write(const int first, const cv::Mat& rows) override;
+  const cv::Mat& Result() const { return result; }
+
+ private:
+  cv::Mat result;
+};
+
+// Headerless file of 8-bit BGR pixels, width * height * 3 bytes, read
+// through a memory mapping, so only the touched rows are paged in.
+class RawSource : public Source {
+ public:
+  RawSource(const std::string& path, const cv::Size& size);
+  cv::Size Size() const override { return size; }
+  int Type() const override { return CV_8UC3; }
+  void Read(const int i, cv::Mat& row) const override;
+
+ private:
+  const cv::Size size;
+  npy::MappedFile file;
+};
+
+class RawSink : public Sink {
+ public:
+  RawSink(const std::string& path, const cv::Size& size);
+  void Write(const int first, const cv::Mat& rows) override;
+
+ private:
+  const cv::Size size;
+  std::mutex mutex;
+  std::ofstream file;
+};
+
+// Both passes split the rows into jobs parts processed in parallel, each with
+// its own sliding windows that start a few rows above the part.
+
+// Pass one: the dark channel is computed in a sliding window of patch_size
+// rows and its brightest pixels are kept by one
+// dcp::AtmosphericLightAccumulator shared by the parts, so the result doesn't
+// depend on jobs; the colors of the averaged pixels are read again at the
+// end.
+cv::Mat EstimateAtmospericLight(const Source& source,
+                                const exec::DehazeParameters& parameters,
+                                const int jobs = 1);
+
+// Pass two: transmission, its box filter and recovery in sliding windows; the
+// sink gets the result in bands of band_rows rows of the source type. The
+// running sums of the box filter restart at every part, so results for
+// different jobs differ by rounding only.
+void RecoverImage(const Source& source, Sink& sink,
+                  const cv::Mat& atmospheric_light,
+                  const exec::DehazeParameters& parameters,
+                  const int band_rows = 64, const int jobs = 1);
+
+// Both passes, the source is read twice. Memory is O(jobs * width *
+// (patch_size + matting_patch_size + band_rows)) and the result equals the
+// one of exec::Executor up to rounding. Returns the atmospheric light.
+cv::Mat Dehaze(const Source& source, Sink& sink,
+               const exec::DehazeParameters& parameters,
+               const int band_rows = 64, const int jobs = 1);
+
+}  // namespace band
+#endif  // BAND_HPP
@@ -0,0 +1,113 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <doctest.h>
+
+#include <band.hpp>
+#include <dcp/dcp.hpp>
+#include <filesystem>
+#include <fstream>
+#include <opencv2/core.hpp>
+#include <stdexcept>
+#include <testing/testing.hpp>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+using testing::HazyImage;
+using testing::SmallParameters;
+
+static cv::Mat InMemory(const cv::Mat& image,
+                        const exec::DehazeParameters& parameters) {
+  exec::Executor executor({image}, exec::DEHAZING, parameters);
+  return executor.Process().back();
+}
+
+TEST_CASE("atmospheric light") {
+  cv::Mat image = HazyImage(cv::Size(47, 31));
+  exec::DehazeParameters parameters = SmallParameters();
+  band::MatSource source(image);
+  cv::Mat ideal = dcp::EstimateAtmospericLight(image, parameters.patch_size,
+                                               parameters.brightest_share);
+  for (int jobs : {1, 3, 40}) {
+    cv::Mat light = band::EstimateAtmospericLight(source, parameters, jobs);
+    CHECK_EQ(cv::norm(light, ideal, cv::NORM_INF), 0);
+  }
+}
+
+TEST_CASE("streamed dehazing") {
+  exec::DehazeParameters parameters = SmallParameters();
+  for (const auto& size : {cv::Size(47, 31), cv::Size(20, 6), cv::Size(9, 1)})
+    for (int band_rows : {1, 7, 64}) {
+      int jobs = band_rows == 7 ? 3 : 1;
+      cv::Mat packed = HazyImage(size);
+      band::MatSource packed_source(packed);
+      band::MatSink packed_sink(size, CV_8UC3);
+      band::Dehaze(packed_source, packed_sink, parameters, band_rows, jobs);
+      CHECK_LE(cv::norm(packed_sink.Result(), InMemory(packed, parameters),
+                        cv::NORM_INF),
+               1);
+
+      cv::Mat image;
+      packed.convertTo(image, CV_64FC3, 1.0 / 255.0);
+      band::MatSource source(image);
+      band::MatSink sink(size, CV_64FC3);
+      band::Dehaze(source, sink, parameters, band_rows, jobs);
+      CHECK_LT(
+          cv::norm(sink.Result(), InMemory(image, parameters), cv::NORM_INF),
+          1e-12);
+    }
+}
+
+TEST_CASE("raw files") {
+  cv::Size size(33, 21);
+  cv::Mat image = HazyImage(size);
+  fs::path dir = fs::temp_directory_path() / "test_band";
+  fs::create_directories(dir);
+  std::string input = (dir / "input.bgr").u8string();
+  std::string output = (dir / "output.bgr").u8string();
+  {
+    std::ofstream file(input, std::ios::binary);
+    for (int i = 0; i < image.rows; ++i)
+      file.write(image.ptr<char>(i), image.cols * 3);
+  }
+  exec::DehazeParameters parameters = SmallParameters();
+  {
+    band::RawSource source(input, size);
+    band::RawSink sink(output, size);
+    band::Dehaze(source, sink, parameters, 4, 2);
+  }
+  band::MatSource source(image);
+  band::MatSink sink(size, CV_8UC3);
+  band::Dehaze(source, sink, parameters, 4, 2);
+  cv::Mat result(size, CV_8UC3);
+  {
+    std::ifstream file(output, std::ios::binary);
+    file.read(result.ptr<char>(), result.total() * 3);
+  }
+  CHECK_EQ(cv::norm(result, sink.Result(), cv::NORM_INF), 0);
+
+  CHECK_THROWS_WITH_AS(band::RawSource(input, cv::Size(32, 21)),
+                       "RawSource::RawSource(...): file size doesn't match "
+                       "the image size",
+                       const std::invalid_argument&);
+  fs::remove_all(dir);
+}
+
+TEST_CASE("parameters") {
+  band::MatSource source(HazyImage(cv::Size(8, 8)));
+  band::MatSink sink(cv::Size(8, 8), CV_8UC3);
+  exec::DehazeParameters parameters = SmallParameters();
+  parameters.scale = 2;
+  CHECK_THROWS_WITH_AS(band::Dehaze(source, sink, parameters),
+                       "EstimateAtmospericLight(...): scale isn't supported",
+                       const std::invalid_argument&);
+  parameters.scale = 1;
+  CHECK_THROWS_WITH_AS(band::Dehaze(source, sink, parameters, 0),
+                       "RecoverImage(...): band_rows must be positive",
+                       const std::invalid_argument&);
+  CHECK_THROWS_WITH_AS(band::Dehaze(source, sink, parameters, 64, 0),
+                       "EstimateAtmospericLight(...): jobs must be positive",
+                       const std::invalid_argument&);
+  CHECK_THROWS_WITH_AS(band::MatSource(cv::Mat(3, 3, CV_32FC3)),
+                       "MatSource::MatSource(...): image has incorrect type",
+                       const std::invalid_argument&);
+}
@@ -0,0 +1,223 @@
+#include <batch.hpp>
+#include <dcp/dcp.hpp>
+#include <haze_model/haze_model.hpp>
+#include <limits>
+#include <opencv2/core.hpp>
+#include <parallel/parallel.hpp>
+#include <stats/stats.hpp>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace batch {
+
+namespace {
+
+void CheckImages(const Tensor& images, const int jobs,
+                 const std::string& name) {
+  if (images.Empty())
+    throw std::invalid_argument(name + "(...): images are empty");
+  if (images.Type() != CV_8UC3 && images.Type() != CV_64FC3)
+    throw std::invalid_argument(name + "(...): images have incorrect type");
+  if (jobs < 1)
+    throw std::invalid_argument(name + "(...): jobs must be positive");
+}
+
+void CheckMaps(const Tensor& maps, const Tensor& images,
+               const std::string& name) {
+  if (maps.Type() != CV_64FC1 || maps.Count() != images.Count() ||
+      maps.Size() != images.Size())
+    throw std::invalid_argument(name +
+                                "(...): maps don't match the images");
+}
+
+void CheckLights(const cv::Mat& atmospheric_lights, const Tensor& images,
+                 const std::string& name) {
+  if (atmospheric_lights.type() != CV_64FC3 ||
+      atmospheric_lights.size() != cv::Size(1, images.Count()))
+    throw std::invalid_argument(name +
+                                "(...): lights don't match the images");
+}
+
+void CheckPatchSize(const int patch_size, const std::string& name) {
+  if (patch_size < 1 || patch_size % 2 == 0)
+    throw std::invalid_argument(name + "(...): patch size is incorrect");
+}
+
+}  // namespace
+
+Tensor::Tensor(const int count, const cv::Size& size, const int type)
+    : count(count), size(size) {
+  if (count < 1)
+    throw std::invalid_argument("Tensor::Tensor(...): incorrect count");
+  if (size.width <= 0 || size.height <= 0)
+    throw std::invalid_argument("Tensor::Tensor(...): incorrect size");
+  data.create(count * size.height, size.width, type);
+}
+
+Tensor::Tensor(const std::vector<cv::Mat>& images)
+    : Tensor(static_cast<int>(images.size()),
+             images.empty() ? cv::Size() : images.front().size(),
+             images.empty() ? CV_8UC3 : images.front().type()) {
+  for (int n = 0; n < count; ++n) {
+    if (images[n].size() != size || images[n].type() != Type())
+      throw std::invalid_argument(
+          "Tensor::Tensor(...): images have different shapes");
+    cv::Mat view = Image(n);
+    images[n].copyTo(view);
+  }
+}
+
+cv::Mat Tensor::Image(const int n) const {
+  if (n < 0 || n >= count)
+    throw std::out_of_range("Tensor::Image(...): no such image");
+  return data.rowRange(n * size.height, (n + 1) * size.height);
+}
+
+Tensor DarkChannel(const Tensor& images, const int patch_size,
+                   const int jobs) {
+  CheckImages(images, jobs, "DarkChannel");
+  CheckPatchSize(patch_size, "DarkChannel");
+  Tensor result(images.Count(), images.Size(), CV_64FC1);
+  // one buffer of channel minimums for the stack instead of one per image
+  Tensor channel_mins(images.Count(), images.Size(), CV_64FC1);
+  parallel::ForEach(images.Count(), jobs, [&](const int n) {
+    cv::Mat min = channel_mins.Image(n);
+    cv::Mat view = result.Image(n);
+    dcp::ChannelMin(images.Image(n), min);
+    dcp::MinFilter(min, patch_size, view);
+  });
+  return result;
+}
+
+cv::Mat EstimateAtmospericLight(const Tensor& images,
+                                const Tensor& dark_channels,
+                                const double brightest_share,
+                                const int jobs) {
+  CheckImages(images, jobs, "EstimateAtmospericLight");
+  CheckMaps(dark_channels, images, "EstimateAtmospericLight");
+  cv::Mat result(images.Count(), 1, CV_64FC3);
+  parallel::ForEach(images.Count(), jobs, [&](const int n) {
+    result.at<cv::Vec3d>(n, 0) =
+        dcp::EstimateAtmospericLight(images.Image(n), dark_channels.Image(n),
+                                     brightest_share)
+            .at<cv::Vec3d>(0, 0);
+  });
+  return result;
+}
+
+cv::Mat EstimateAtmospericLightQuadTree(const Tensor& images,
+                                        const int jobs) {
+  CheckImages(images, jobs, "EstimateAtmospericLightQuadTree");
+  cv::Mat result(images.Count(), 1, CV_64FC3);
+  parallel::ForEach(images.Count(), jobs, [&](const int n) {
+    result.at<cv::Vec3d>(n, 0) =
+        dcp::EstimateAtmospericLightQuadTree(images.Image(n))
+            .at<cv::Vec3d>(0, 0);
+  });
+  return result;
+}
+
+Tensor EstimateTransmission(const Tensor& images,
+                            const cv::Mat& atmospheric_lights,
+                            const int patch_size, const double omega,
+                            const int jobs) {
+  CheckImages(images, jobs, "EstimateTransmission");
+  CheckLights(atmospheric_lights, images, "EstimateTransmission");
+  CheckPatchSize(patch_size, "EstimateTransmission");
+  Tensor result(images.Count(), images.Size(), CV_64FC1);
+  Tensor normalized_mins(images.Count(), images.Size(), CV_64FC1);
+  parallel::ForEach(images.Count(), jobs, [&](const int n) {
+    cv::Mat min = normalized_mins.Image(n);
+    cv::Mat view = result.Image(n);
+    dcp::NormalizedChannelMin(images.Image(n), atmospheric_lights.row(n),
+                              min);
+    dcp::MinFilter(min, patch_size, view);
+    // 1 - omega * the filtered minimum, as dcp::EstimateTransmission, in
+    // place
+    view.convertTo(view, -1, -omega, 1.0);
+  });
+  return result;
+}
+
+Tensor SoftMatting(const Tensor& transmissions, const int patch_size,
+                   const int jobs) {
+  if (transmissions.Empty() || transmissions.Type() != CV_64FC1)
+    throw std::invalid_argument(
+        "SoftMatting(...): transmissions have incorrect type");
+  if (patch_size < 1)
+    throw std::invalid_argument("SoftMatting(...): patch size is incorrect");
+  if (jobs < 1)
+    throw std::invalid_argument("SoftMatting(...): jobs must be positive");
+  Tensor result(transmissions.Count(), transmissions.Size(), CV_64FC1);
+  parallel::ForEach(transmissions.Count(), jobs, [&](const int n) {
+    cv::Mat view = result.Image(n);
+    dcp::BoxFilter(transmissions.Image(n), patch_size, view);
+  });
+  return result;
+}
+
+Tensor RecoverImages(const Tensor& images, const Tensor& transmissions,
+                     const cv::Mat& atmospheric_lights, const double t0,
+                     const int jobs) {
+  CheckImages(images, jobs, "RecoverImages");
+  CheckMaps(transmissions, images, "RecoverImages");
+  CheckLights(atmospheric_lights, images, "RecoverImages");
+  Tensor result(images.Count(), images.Size(), images.Type());
+  parallel::ForEach(images.Count(), jobs, [&](const int n) {
+    haze::HazeModel model(transmissions.Image(n), atmospheric_lights.row(n),
+                          t0);
+    cv::Mat view = result.Image(n);
+    model.RecoverImage(view, images.Image(n));
+  });
+  return result;
+}
+
+std::vector<Tensor> Dehaze(const Tensor& images,
+                           const exec::DehazeParameters& parameters,
+                           const int jobs) {
+  CheckImages(images, jobs, "Dehaze");
+  if (parameters.scale != 1)
+    throw std::invalid_argument("Dehaze(...): scale isn't supported");
+  // one range check for the whole stack instead of one per image
+  if (images.Type() == CV_64FC3) {
+    try {
+      cv::checkRange(images.Data(), false, 0,
+                     -std::numeric_limits<double>::epsilon(),
+                     1.0 + std::numeric_limits<double>::epsilon());
+    } catch (...) {
+      throw std::invalid_argument("Dehaze(...): images are out of range");
+    }
+  }
+  std::vector<Tensor> res;
+  {
+    stats::ScopedTimer timer("dark_channel");
+    res.push_back(DarkChannel(images, parameters.patch_size, jobs));
+  }
+  cv::Mat atmospheric_lights;
+  {
+    stats::ScopedTimer timer("atmospheric_light");
+    atmospheric_lights =
+        parameters.atmospheric_light_method == dcp::QUAD_TREE
+            ? EstimateAtmospericLightQuadTree(images, jobs)
+            : EstimateAtmospericLight(images, res.back(),
+                                      parameters.brightest_share, jobs);
+  }
+  {
+    stats::ScopedTimer timer("transmission");
+    res.push_back(EstimateTransmission(images, atmospheric_lights,
+                                       parameters.patch_size,
+                                       parameters.omega, jobs));
+  }
+  Tensor matting_tr;
+  {
+    stats::ScopedTimer timer("refinement");
+    matting_tr = SoftMatting(res.back(), parameters.matting_patch_size, jobs);
+  }
+  stats::ScopedTimer timer("recovery");
+  res.push_back(RecoverImages(images, matting_tr, atmospheric_lights,
+                              parameters.t0, jobs));
+  return res;
+}
+
+}  // namespace batch
@@ -0,0 +1,81 @@
+#pragma once
+#ifndef BATCH_HPP
+#define BATCH_HPP
+
+#include <executor/executor.hpp>
+#include <opencv2/core/mat.hpp>
+#include <vector>
+
+namespace batch {
+
+// Stack of count images of the same size and type in NHWC layout: image n
+// is rows [n * height, (n + 1) * height) of one continuous (count * height)
+// x width Mat, so an image is a view and a stage fills the whole stack in
+// one buffer. Copies share the data, as cv::Mat does.
+class Tensor {
+ public:
+  Tensor() = default;
+  Tensor(const int count, const cv::Size& size, const int type);
+  // copies images of the same size and type
+  explicit Tensor(const std::vector<cv::Mat>& images);
+  ~Tensor() = default;
+
+  int Count() const { return count; }
+  cv::Size Size() const { return size; }
+  int Type() const { return data.type(); }
+  bool Empty() const { return count == 0; }
+  // view of image n without copying
+  cv::Mat Image(const int n) const;
+  // all images, (Count() * height) x width
+  const cv::Mat& Data() const { return data; }
+
+ private:
+  int count = 0;
+  cv::Size size;
+  cv::Mat data;
+};
+
+// Every stage checks its arguments once for the whole stack and processes
+// the images on jobs threads, each taking whole images, so small images keep
+// the cores busy without tiling. Images are CV_8UC3 or CV_64FC3 in [0, 1];
+// the results are those of the dcp functions for every image, written by
+// their output forms straight into the views of the result.
+
+// CV_64FC1 dark channels.
+Tensor DarkChannel(const Tensor& images, const int patch_size,
+                   const int jobs = 1);
+
+// count x 1 CV_64FC3, the light of image n in row n.
+cv::Mat EstimateAtmospericLight(const Tensor& images,
+                                const Tensor& dark_channels,
+                                const double brightest_share = 1e-3,
+                                const int jobs = 1);
+
+cv::Mat EstimateAtmospericLightQuadTree(const Tensor& images,
+                                        const int jobs = 1);
+
+// CV_64FC1 transmissions for the lights in the rows of atmospheric_lights.
+Tensor EstimateTransmission(const Tensor& images,
+                            const cv::Mat& atmospheric_lights,
+                            const int patch_size, const double omega = 0.95,
+                            const int jobs = 1);
+
+// Box filter of the transmissions, see dcp::SoftMatting.
+Tensor SoftMatting(const Tensor& transmissions, const int patch_size,
+                   const int jobs = 1);
+
+// Results of the type of the images.
+Tensor RecoverImages(const Tensor& images, const Tensor& transmissions,
+                     const cv::Mat& atmospheric_lights, const double t0 = 0.1,
+                     const int jobs = 1);
+
+// All stages at scale 1, as exec::Executor does for every image: returns the
+// dark channels, the transmissions and the results. The histogram light is
+// taken from the dark channel directly, the selected pixels are the same.
+std::vector<Tensor> Dehaze(const Tensor& images,
+                           const exec::DehazeParameters& parameters =
+                               exec::DehazeParameters(),
+                           const int jobs = 1);
+
+}  // namespace batch
+#endif  // BATCH_HPP
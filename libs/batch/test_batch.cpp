@@ -0,0 +1,91 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <doctest.h>
+
+#include <batch.hpp>
+#include <dcp/dcp.hpp>
+#include <opencv2/core.hpp>
+#include <stdexcept>
+#include <testing/testing.hpp>
+#include <vector>
+
+using testing::HazyImages;
+using testing::SmallParameters;
+
+TEST_CASE("tensor layout") {
+  std::vector<cv::Mat> images = HazyImages(3, cv::Size(11, 7));
+  batch::Tensor tensor(images);
+  CHECK_EQ(tensor.Count(), 3);
+  CHECK_EQ(tensor.Size(), cv::Size(11, 7));
+  CHECK_EQ(tensor.Type(), CV_8UC3);
+  CHECK_EQ(tensor.Data().size(), cv::Size(11, 21));
+  CHECK(tensor.Data().isContinuous());
+  for (int n = 0; n < 3; ++n)
+    CHECK_EQ(cv::norm(tensor.Image(n), images[n], cv::NORM_INF), 0);
+  // views and copies share the data
+  batch::Tensor shared = tensor;
+  tensor.Image(1).setTo(cv::Scalar::all(7));
+  CHECK_EQ(shared.Data().at<cv::Vec3b>(7, 0)[0], 7);
+  CHECK_THROWS_AS(tensor.Image(3), const std::out_of_range&);
+  images.push_back(cv::Mat(7, 12, CV_8UC3));
+  CHECK_THROWS_WITH_AS(batch::Tensor{images},
+                       "Tensor::Tensor(...): images have different shapes",
+                       const std::invalid_argument&);
+  CHECK_THROWS_WITH_AS(batch::Tensor(std::vector<cv::Mat>()),
+                       "Tensor::Tensor(...): incorrect count",
+                       const std::invalid_argument&);
+}
+
+TEST_CASE("batched dehazing matches Executor") {
+  exec::DehazeParameters parameters = SmallParameters();
+  std::vector<cv::Mat> packed = HazyImages(5, cv::Size(32, 24));
+  std::vector<cv::Mat> unpacked(packed.size());
+  for (size_t n = 0; n < packed.size(); ++n)
+    packed[n].convertTo(unpacked[n], CV_64FC3, 1.0 / 255.0);
+  for (const auto& images : {packed, unpacked})
+    for (int jobs : {1, 3, 8}) {
+      CAPTURE(jobs);
+      std::vector<batch::Tensor> res =
+          batch::Dehaze(batch::Tensor(images), parameters, jobs);
+      REQUIRE_EQ(res.size(), 3);
+      CHECK_EQ(res.back().Type(), images.front().type());
+      for (size_t n = 0; n < images.size(); ++n) {
+        exec::Executor executor({images[n]}, exec::DEHAZING, parameters);
+        std::vector<cv::Mat> ideal = executor.Process();
+        for (size_t k = 0; k < ideal.size(); ++k)
+          CHECK_LT(cv::norm(res[k].Image(static_cast<int>(n)), ideal[k],
+                            cv::NORM_INF),
+                   1e-12);
+      }
+    }
+}
+
+TEST_CASE("stages") {
+  std::vector<cv::Mat> images = HazyImages(4, cv::Size(40, 40));
+  batch::Tensor tensor(images);
+  cv::Mat lights = batch::EstimateAtmospericLightQuadTree(tensor, 2);
+  CHECK_EQ(lights.size(), cv::Size(1, 4));
+  for (int n = 0; n < 4; ++n)
+    CHECK_EQ(cv::norm(lights.row(n),
+                      dcp::EstimateAtmospericLightQuadTree(images[n]),
+                      cv::NORM_INF),
+             0);
+  batch::Tensor dark_channels = batch::DarkChannel(tensor, 5, 2);
+  CHECK_THROWS_WITH_AS(
+      batch::EstimateTransmission(tensor, lights.rowRange(0, 3), 5),
+      "EstimateTransmission(...): lights don't match the images",
+      const std::invalid_argument&);
+  CHECK_THROWS_WITH_AS(
+      batch::RecoverImages(tensor, dark_channels, lights, 0.1, 0),
+      "RecoverImages(...): jobs must be positive",
+      const std::invalid_argument&);
+  exec::DehazeParameters parameters = SmallParameters();
+  parameters.scale = 2;
+  CHECK_THROWS_WITH_AS(batch::Dehaze(tensor, parameters),
+                       "Dehaze(...): scale isn't supported",
+                       const std::invalid_argument&);
+  batch::Tensor bright(1, cv::Size(3, 3), CV_64FC3);
+  bright.Image(0).setTo(cv::Scalar::all(2));
+  CHECK_THROWS_WITH_AS(batch::Dehaze(bright),
+                       "Dehaze(...): images are out of range",
+                       const std::invalid_argument&);
+}
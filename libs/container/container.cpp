@@ -0,0 +1,283 @@
+#include <algorithm>
+#include <container.hpp>
+#include <cstring>
+#include <opencv2/core.hpp>
+#include <opencv2/imgcodecs.hpp>
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace pack {
+
+namespace {
+
+const char header_magic[8] = {'D', 'C', 'P', 'P', 'A', 'C', 'K', '1'};
+const char index_magic[8] = {'D', 'C', 'P', 'I', 'N', 'D', 'E', 'X'};
+const uint64_t header_size = 16;
+const uint64_t trailer_size = 24;
+const uint64_t alignment = 64;
+
+uint64_t Align(const uint64_t value, const uint64_t to) {
+  return (value + to - 1) / to * to;
+}
+
+template <typename T>
+void Put(std::vector<char>& buffer, const T& value) {
+  const char* bytes = reinterpret_cast<const char*>(&value);
+  buffer.insert(buffer.end(), bytes, bytes + sizeof(T));
+}
+
+void PutString(std::vector<char>& buffer, const std::string& str) {
+  Put(buffer, static_cast<uint32_t>(str.size()));
+  buffer.insert(buffer.end(), str.begin(), str.end());
+}
+
+class Cursor {
+ public:
+  Cursor(const unsigned char* data, const uint64_t size)
+      : data(data), size(size) {}
+  template <typename T>
+  T Get() {
+    Check(sizeof(T));
+    T value;
+    std::memcpy(&value, data + position, sizeof(T));
+    position += sizeof(T);
+    return value;
+  }
+  std::string GetString() {
+    uint32_t length = Get<uint32_t>();
+    Check(length);
+    std::string str(reinterpret_cast<const char*>(data) + position, length);
+    position += length;
+    return str;
+  }
+
+ private:
+  void Check(const uint64_t bytes) const {
+    if (position + bytes > size)
+      throw std::runtime_error("Reader::Reader(...): index is corrupted");
+  }
+  const unsigned char* data;
+  uint64_t size;
+  uint64_t position = 0;
+};
+
+}  // namespace
+
+#ifdef _WIN32
+Writer::Writer(const std::string& path, const uint64_t extent_size)
+    : extent_size(extent_size) {
+  if (extent_size == 0)
+    throw std::invalid_argument("Writer::Writer(...): extent can't be empty");
+  file = CreateFileA(path.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS,
+                     FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (file == INVALID_HANDLE_VALUE)
+    throw std::runtime_error("Writer::Writer(...): cannot create file");
+  char header[header_size] = {};
+  std::memcpy(header, header_magic, sizeof(header_magic));
+  Resize(Align(header_size, extent_size));
+  allocated = Align(header_size, extent_size);
+  WriteAt(0, header, header_size);
+  end = Align(header_size, alignment);
+}
+
+void Writer::WriteAt(const uint64_t offset, const void* data,
+                     const uint64_t size) {
+  const char* bytes = static_cast<const char*>(data);
+  for (uint64_t done = 0; done < size;) {
+    OVERLAPPED overlapped = {};
+    overlapped.Offset = static_cast<DWORD>(offset + done);
+    overlapped.OffsetHigh = static_cast<DWORD>((offset + done) >> 32);
+    DWORD chunk = static_cast<DWORD>(std::min<uint64_t>(size - done, 1 << 30));
+    DWORD written = 0;
+    if (!WriteFile(file, bytes + done, chunk, &written, &overlapped) ||
+        written == 0)
+      throw std::runtime_error("Writer::WriteAt(...): cannot write");
+    done += written;
+  }
+}
+
+void Writer::Resize(const uint64_t size) {
+  LARGE_INTEGER position;
+  position.QuadPart = static_cast<LONGLONG>(size);
+  if (!SetFilePointerEx(file, position, nullptr, FILE_BEGIN) ||
+      !SetEndOfFile(file))
+    throw std::runtime_error("Writer::Resize(...): cannot resize file");
+}
+#else
+Writer::Writer(const std::string& path, const uint64_t extent_size)
+    : extent_size(extent_size) {
+  if (extent_size == 0)
+    throw std::invalid_argument("Writer::Writer(...): extent can't be empty");
+  file = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (file < 0)
+    throw std::runtime_error("Writer::Writer(...): cannot create file");
+  char header[header_size] = {};
+  std::memcpy(header, header_magic, sizeof(header_magic));
+  Resize(Align(header_size, extent_size));
+  allocated = Align(header_size, extent_size);
+  WriteAt(0, header, header_size);
+  end = Align(header_size, alignment);
+}
+
+void Writer::WriteAt(const uint64_t offset, const void* data,
+                     const uint64_t size) {
+  const char* bytes = static_cast<const char*>(data);
+  for (uint64_t done = 0; done < size;) {
+    ssize_t written = pwrite(file, bytes + done, size - done,
+                             static_cast<off_t>(offset + done));
+    if (written <= 0)
+      throw std::runtime_error("Writer::WriteAt(...): cannot write");
+    done += static_cast<uint64_t>(written);
+  }
+}
+
+void Writer::Resize(const uint64_t size) {
+#ifdef __linux__
+  // growing extents get real blocks, so appenders don't hit a full disk midway
+  if (size > allocated &&
+      posix_fallocate(file, 0, static_cast<off_t>(size)) == 0)
+    return;
+#endif
+  if (ftruncate(file, static_cast<off_t>(size)) != 0)
+    throw std::runtime_error("Writer::Resize(...): cannot resize file");
+}
+#endif
+
+Writer::~Writer() {
+  try {
+    Close();
+  } catch (...) {
+  }
+}
+
+void Writer::Append(const std::string& name, const cv::Mat& image) {
+  if (image.empty())
+    throw std::invalid_argument("Writer::Append(...): image is empty");
+  cv::Mat continuous = image.isContinuous() ? image : image.clone();
+  Entry entry;
+  entry.rows = continuous.rows;
+  entry.cols = continuous.cols;
+  entry.type = continuous.type();
+  Append(name, entry, continuous.data,
+         continuous.total() * continuous.elemSize());
+}
+
+void Writer::Append(const std::string& name, const Entry& entry,
+                    const void* data, const uint64_t size) {
+  Entry record = entry;
+  record.size = size;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (closed) throw std::runtime_error("Writer::Append(...): closed");
+    if (!names.insert(name).second)
+      throw std::invalid_argument("Writer::Append(...): duplicate name " +
+                                  name);
+    record.offset = end;
+    end = Align(end + size, alignment);
+    if (end > allocated) {
+      Resize(Align(end, extent_size));
+      allocated = Align(end, extent_size);
+    }
+  }
+  WriteAt(record.offset, data, size);
+  std::lock_guard<std::mutex> lock(mutex);
+  index.emplace_back(name, record);
+}
+
+void Writer::Close() {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (closed) return;
+  closed = true;
+  std::vector<char> buffer;
+  for (const auto& [name, entry] : index) {
+    PutString(buffer, name);
+    PutString(buffer, entry.codec);
+    Put(buffer, entry.offset);
+    Put(buffer, entry.size);
+    Put(buffer, entry.rows);
+    Put(buffer, entry.cols);
+    Put(buffer, entry.type);
+  }
+  uint64_t index_offset = end;
+  Put(buffer, index_offset);
+  Put(buffer, static_cast<uint64_t>(index.size()));
+  buffer.insert(buffer.end(), index_magic, index_magic + sizeof(index_magic));
+  Resize(index_offset + buffer.size());
+  WriteAt(index_offset, buffer.data(), buffer.size());
+#ifdef _WIN32
+  CloseHandle(file);
+#else
+  close(file);
+#endif
+}
+
+Reader::Reader(const std::string& path) : file(path) {
+  const unsigned char* data = file.Data();
+  uint64_t size = file.Size();
+  if (size < header_size + trailer_size ||
+      std::memcmp(data, header_magic, sizeof(header_magic)) != 0 ||
+      std::memcmp(data + size - sizeof(index_magic), index_magic,
+                  sizeof(index_magic)) != 0)
+    throw std::runtime_error("Reader::Reader(...): file isn't a container");
+  Cursor trailer(data + size - trailer_size, trailer_size);
+  uint64_t index_offset = trailer.Get<uint64_t>();
+  uint64_t count = trailer.Get<uint64_t>();
+  if (index_offset > size - trailer_size)
+    throw std::runtime_error("Reader::Reader(...): index is corrupted");
+  Cursor cursor(data + index_offset, size - trailer_size - index_offset);
+  for (uint64_t i = 0; i < count; ++i) {
+    std::string name = cursor.GetString();
+    Entry entry;
+    entry.codec = cursor.GetString();
+    entry.offset = cursor.Get<uint64_t>();
+    entry.size = cursor.Get<uint64_t>();
+    entry.rows = cursor.Get<int32_t>();
+    entry.cols = cursor.Get<int32_t>();
+    entry.type = cursor.Get<int32_t>();
+    if (entry.offset + entry.size > index_offset)
+      throw std::runtime_error("Reader::Reader(...): index is corrupted");
+    names.push_back(name);
+    entries.emplace(name, entry);
+  }
+}
+
+bool Reader::Contains(const std::string& name) const {
+  return entries.count(name) != 0;
+}
+
+const Entry& Reader::Find(const std::string& name) const {
+  auto it = entries.find(name);
+  if (it == entries.end())
+    throw std::out_of_range("Reader::Find(...): no record " + name);
+  return it->second;
+}
+
+const unsigned char* Reader::Data(const Entry& entry) const {
+  return file.Data() + entry.offset;
+}
+
+cv::Mat Reader::Image(const std::string& name) const {
+  const Entry& entry = Find(name);
+  if (entry.codec == "raw") {
+    if (static_cast<uint64_t>(entry.rows) * entry.cols *
+            CV_ELEM_SIZE(entry.type) !=
+        entry.size)
+      throw std::runtime_error("Reader::Image(...): record is corrupted");
+    return cv::Mat(entry.rows, entry.cols, entry.type,
+                   const_cast<unsigned char*>(Data(entry)));
+  }
+  cv::Mat encoded(1, static_cast<int>(entry.size), CV_8UC1,
+                  const_cast<unsigned char*>(Data(entry)));
+  cv::Mat result = cv::imdecode(encoded, cv::IMREAD_UNCHANGED);
+  if (result.empty())
+    throw std::runtime_error("Reader::Image(...): cannot decode " + name);
+  return result;
+}
+
+}  // namespace pack
@@ -0,0 +1,99 @@
+#pragma once
+#ifndef CONTAINER_HPP
+#define CONTAINER_HPP
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <npy/npy.hpp>
+#include <opencv2/core/mat.hpp>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace pack {
+
+// Layout: 16-byte header, records aligned to 64 bytes, the index and a 24-byte
+// trailer pointing at it. Numbers are stored in the host (little-endian)
+// order.
+struct Entry {
+  uint64_t offset = 0;
+  uint64_t size = 0;
+  int32_t rows = 0;
+  int32_t cols = 0;
+  // OpenCV type of the decoded image
+  int32_t type = 0;
+  // "raw" for pixel data, otherwise the image extension, e.g. ".png"
+  std::string codec = "raw";
+};
+
+// Append-only writer. Append may be called from several threads at once: a
+// record's place is reserved under a lock and the data is written outside of
+// it. The file grows by preallocated extents and is trimmed on Close.
+class Writer {
+ public:
+  Writer() = delete;
+  Writer(const Writer&) = delete;
+  Writer(Writer&&) = delete;
+  Writer& operator=(const Writer&) = delete;
+  Writer& operator=(Writer&&) = delete;
+  explicit Writer(const std::string& path,
+                  const uint64_t extent_size = 64 << 20);
+  // Closes the container if Close wasn't called; errors are swallowed.
+  ~Writer();
+  // Stores the pixels of the image as a raw record.
+  void Append(const std::string& name, const cv::Mat& image);
+  // Stores already encoded data; offset and size of the entry are ignored.
+  void Append(const std::string& name, const Entry& entry, const void* data,
+              const uint64_t size);
+  // Writes the index once all appenders are done; no records may be appended
+  // afterwards.
+  void Close();
+
+ private:
+  void WriteAt(const uint64_t offset, const void* data, const uint64_t size);
+  void Resize(const uint64_t size);
+
+  const uint64_t extent_size;
+  std::mutex mutex;
+  uint64_t end = 0;
+  uint64_t allocated = 0;
+  std::unordered_set<std::string> names;
+  std::vector<std::pair<std::string, Entry>> index;
+  bool closed = false;
+#ifdef _WIN32
+  void* file = nullptr;
+#else
+  int file = -1;
+#endif
+};
+
+// Reads a closed container through a memory mapping; raw records are returned
+// as views without copying.
+class Reader {
+ public:
+  Reader() = delete;
+  Reader(const Reader&) = delete;
+  Reader(Reader&&) = delete;
+  Reader& operator=(const Reader&) = delete;
+  Reader& operator=(Reader&&) = delete;
+  explicit Reader(const std::string& path);
+  ~Reader() = default;
+  // names in the order the records were appended
+  const std::vector<std::string>& Names() const { return names; }
+  bool Contains(const std::string& name) const;
+  const Entry& Find(const std::string& name) const;
+  const unsigned char* Data(const Entry& entry) const;
+  // Raw records are views valid while the Reader lives, others are decoded.
+  cv::Mat Image(const std::string& name) const;
+
+ private:
+  npy::MappedFile file;
+  std::vector<std::string> names;
+  std::unordered_map<std::string, Entry> entries;
+};
+
+}  // namespace pack
+#endif  // CONTAINER_HPP
@@ -0,0 +1,70 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <doctest.h>
+
+#include <filesystem>
+#include <opencv2/core.hpp>
+#include <opencv2/imgcodecs.hpp>
+#include <stdexcept>
+#include <thread>
+
+#include "container.hpp"
+
+namespace fs = std::filesystem;
+
+TEST_CASE("Writer and Reader") {
+  fs::path path = fs::temp_directory_path() / "test_container.pack";
+  cv::Mat image(5, 7, CV_8UC3);
+  cv::RNG rng(42);
+  rng.fill(image, cv::RNG::UNIFORM, 0, 256);
+  cv::Mat plane(5, 7, CV_32FC1, cv::Scalar(0.25));
+  std::vector<unsigned char> png;
+  cv::imencode(".png", image, png);
+  {
+    // a tiny extent makes the file grow while records are appended
+    pack::Writer writer(path.string(), 128);
+    writer.Append("image", image);
+    writer.Append("plane", plane);
+    pack::Entry entry;
+    entry.codec = ".png";
+    entry.rows = image.rows;
+    entry.cols = image.cols;
+    entry.type = image.type();
+    writer.Append("compressed", entry, png.data(), png.size());
+    REQUIRE_THROWS_AS(writer.Append("image", image),
+                      const std::invalid_argument&);
+    writer.Close();
+    REQUIRE_THROWS_AS(writer.Append("late", image), const std::runtime_error&);
+  }
+  pack::Reader reader(path.string());
+  REQUIRE_EQ(reader.Names().size(), 3);
+  CHECK_EQ(reader.Names()[0], "image");
+  CHECK_EQ(reinterpret_cast<uintptr_t>(reader.Data(reader.Find("plane"))) % 64,
+           0);
+  CHECK_EQ(cv::norm(reader.Image("image"), image, cv::NORM_INF), 0.0);
+  CHECK_EQ(cv::norm(reader.Image("plane"), plane, cv::NORM_INF), 0.0);
+  CHECK_EQ(cv::norm(reader.Image("compressed"), image, cv::NORM_INF), 0.0);
+  CHECK_FALSE(reader.Contains("missing"));
+  REQUIRE_THROWS_AS(reader.Find("missing"), const std::out_of_range&);
+  fs::remove(path);
+}
+
+TEST_CASE("concurrent appenders") {
+  fs::path path = fs::temp_directory_path() / "test_container_threads.pack";
+  {
+    pack::Writer writer(path.string(), 4096);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t)
+      threads.emplace_back([&writer, t]() {
+        for (int i = 0; i < 25; ++i) {
+          cv::Mat image(3, 3, CV_8UC1, cv::Scalar(t * 25 + i));
+          writer.Append(std::to_string(t * 25 + i), image);
+        }
+      });
+    for (auto& thread : threads) thread.join();
+  }
+  pack::Reader reader(path.string());
+  REQUIRE_EQ(reader.Names().size(), 100);
+  for (int i = 0; i < 100; ++i)
+    CHECK_EQ(reader.Image(std::to_string(i)).at<unsigned char>(2, 2), i);
+  fs::remove(path);
+}
@@ -1,38 +1,202 @@
 #include <dcp.hpp>
+#include <algorithm>
+#include <cmath>
 #include <iostream>
 #include <opencv2/core.hpp>
 #include <opencv2/imgproc.hpp>
+#include <sat/sat.hpp>
+#include <simd/simd.hpp>
+#include <limits>
 #include <stdexcept>
+#include <string>
 #include <vector>
 
 namespace dcp {
 
+AtmosphericLightMethod ParseAtmosphericLightMethod(const std::string& name) {
+  if (name == "top") return TOP_DARK_CHANNEL;
+  if (name == "histogram") return DARK_CHANNEL_HISTOGRAM;
+  if (name == "quadtree") return QUAD_TREE;
+  throw std::invalid_argument(
+      "ParseAtmosphericLightMethod(...): unknown method " + name);
+}
+
+static int DarkChannelBin(const double val) {
+  if (!(val > 0)) return 0;
+  if (val >= 1) return dark_channel_bins - 1;
+  return std::min(dark_channel_bins - 1,
+                  static_cast<int>(val * dark_channel_bins));
+}
+
+static cv::Mat Gray(const cv::Mat& image) {
+  std::vector<cv::Mat> colors;
+  cv::split(image, colors);
+  return (colors[0] + colors[1] + colors[2]) / 3.0;
+}
+
+// Running column sums are updated by the dispatched kernel, then summed along
+// the row. Every call filters a new image once, so a summed-area table
+// wouldn't be reused.
+void BoxFilter(const cv::Mat& image, const int ksize, cv::Mat& result) {
+  result.create(image.size(), image.type());
+  if (image.type() != CV_64FC1) {
+    cv::boxFilter(image, result, -1, cv::Size(ksize, ksize));
+    return;
+  }
+  int before = ksize / 2;
+  int after = ksize - 1 - before;
+  cv::Mat padded;
+  cv::copyMakeBorder(image, padded, before, after, before, after,
+                     cv::BORDER_REFLECT_101);
+  std::vector<double> column(padded.cols, 0.0);
+  std::vector<double> zeros(padded.cols, 0.0);
+  for (int k = 0; k < ksize - 1; ++k)
+    simd::Accumulate(column.data(), padded.ptr<double>(k), zeros.data(),
+                     column.size());
+  double scale = 1.0 / (ksize * ksize);
+  for (int i = 0; i < image.rows; ++i) {
+    simd::Accumulate(column.data(), padded.ptr<double>(i + ksize - 1),
+                     i > 0 ? padded.ptr<double>(i - 1) : zeros.data(),
+                     column.size());
+    double* dst = result.ptr<double>(i);
+    double sum = 0;
+    for (int d = 0; d < ksize - 1; ++d) sum += column[d];
+    for (int j = 0; j < image.cols; ++j) {
+      sum += column[j + ksize - 1];
+      dst[j] = sum * scale;
+      sum -= column[j];
+    }
+  }
+}
+
+static cv::Mat Box(const cv::Mat& image, const int radius) {
+  cv::Mat result;
+  BoxFilter(image, 2 * radius + 1, result);
+  return result;
+}
+
+static bool IsColor(const cv::Mat& image) {
+  return image.type() == CV_64FC3 || image.type() == CV_8UC3;
+}
+
+cv::Vec3d Pixel(const cv::Mat& image, const int i, const int j) {
+  if (image.depth() == CV_64F) return image.at<cv::Vec3d>(i, j);
+  cv::Vec3b pixel = image.at<cv::Vec3b>(i, j);
+  return cv::Vec3d(pixel[0], pixel[1], pixel[2]) / 255.0;
+}
+
+// min over colors of lut[c][value], written as doubles; the lookup unpacks
+// 8-bit pixels on the fly, so no CV_64FC3 copy of the image is made
+static void ChannelMinLUT(const cv::Mat& image, const double lut[3][256],
+                          cv::Mat& min) {
+  min.create(image.size(), CV_64FC1);
+  for (int i = 0; i < image.rows; ++i) {
+    const unsigned char* src = image.ptr<unsigned char>(i);
+    double* dst = min.ptr<double>(i);
+    for (int j = 0; j < image.cols; ++j, src += 3)
+      dst[j] = std::min({lut[0][src[0]], lut[1][src[1]], lut[2][src[2]]});
+  }
+}
+
+// MinFilter that counts the values of the result into histogram as the rows
+// are done, if it's given
+static void MinFilterCounting(const cv::Mat& channel_min,
+                              const int patch_size,
+                              std::vector<size_t>* histogram,
+                              cv::Mat& dark_channel) {
+  if (patch_size % 2 == 0)
+    throw std::invalid_argument("MinFilter(...): patch size can't be even");
+  if (channel_min.type() != CV_64FC1)
+    throw std::invalid_argument(
+        "MinFilter(...): channel_min has incorrect type");
+  // separable erosion with a replicated border, i.e. the windows are clamped;
+  // the vertical pass is written into the result, and every row is padded
+  // before the horizontal pass overwrites it
+  int radius = patch_size / 2;
+  int rows = channel_min.rows;
+  int cols = channel_min.cols;
+  dark_channel.create(channel_min.size(), CV_64FC1);
+  for (int i = 0; i < rows; ++i) {
+    int first = std::max(0, i - radius);
+    int last = std::min(rows - 1, i + radius);
+    double* dst = dark_channel.ptr<double>(i);
+    std::copy_n(channel_min.ptr<double>(first), cols, dst);
+    for (int k = first + 1; k <= last; ++k)
+      simd::Min(dst, channel_min.ptr<double>(k), dst, cols);
+  }
+  std::vector<double> padded(cols + 2 * radius);
+  for (int i = 0; i < rows; ++i) {
+    double* dst = dark_channel.ptr<double>(i);
+    std::fill_n(padded.begin(), radius, dst[0]);
+    std::copy_n(dst, cols, padded.begin() + radius);
+    std::fill_n(padded.begin() + radius + cols, radius, dst[cols - 1]);
+    std::copy_n(padded.data(), cols, dst);
+    for (int d = 1; d <= 2 * radius; ++d)
+      simd::Min(dst, padded.data() + d, dst, cols);
+    if (histogram != nullptr)
+      for (int j = 0; j < cols; ++j) ++(*histogram)[DarkChannelBin(dst[j])];
+  }
+}
+
 cv::Mat DarkChannel(const cv::Mat& image, const int patch_size) {
   if (patch_size % 2 == 0)
     throw std::invalid_argument("DarkChannel(...): patch size can't be even");
-  if (image.type() != CV_64FC3)
+  if (!IsColor(image))
     throw std::invalid_argument("DarkChannel(...): image has incorrect type");
-  std::vector<cv::Mat> colors;
-  cv::Mat min_bg(image.size(), CV_64FC1);
-  cv::split(image, colors);
-  cv::Mat min(image.size(), CV_64FC1);
-  cv::min(colors[0], colors[1], min_bg);
-  cv::min(min_bg, colors[2], min);
-  cv::Mat struct_el = cv::getStructuringElement(
-      cv::MORPH_RECT, cv::Size(patch_size, patch_size));
-  cv::Mat dark_channel(image.size(), CV_64FC1);
-  cv::erode(min, dark_channel, struct_el, cv::Point(-1, -1), 1,
-            cv::BORDER_REPLICATE);
+  return MinFilter(ChannelMin(image), patch_size);
+}
+
+cv::Mat DarkChannel(const cv::Mat& image, const int patch_size,
+                    std::vector<size_t>& histogram) {
+  if (patch_size % 2 == 0)
+    throw std::invalid_argument("DarkChannel(...): patch size can't be even");
+  if (!IsColor(image))
+    throw std::invalid_argument("DarkChannel(...): image has incorrect type");
+  histogram.assign(dark_channel_bins, 0);
+  cv::Mat dark_channel;
+  MinFilterCounting(ChannelMin(image), patch_size, &histogram, dark_channel);
   return dark_channel;
 }
 
+cv::Mat ChannelMin(const cv::Mat& image) {
+  cv::Mat min;
+  ChannelMin(image, min);
+  return min;
+}
+
+void ChannelMin(const cv::Mat& image, cv::Mat& min) {
+  if (!IsColor(image))
+    throw std::invalid_argument("ChannelMin(...): image has incorrect type");
+  if (image.depth() == CV_8U) {
+    double lut[3][256];
+    for (int v = 0; v < 256; ++v)
+      lut[0][v] = lut[1][v] = lut[2][v] = v / 255.0;
+    ChannelMinLUT(image, lut, min);
+    return;
+  }
+  min.create(image.size(), CV_64FC1);
+  for (int i = 0; i < image.rows; ++i)
+    simd::ChannelMin(image.ptr<double>(i), min.ptr<double>(i), image.cols);
+}
+
+cv::Mat MinFilter(const cv::Mat& channel_min, const int patch_size) {
+  cv::Mat dark_channel;
+  MinFilter(channel_min, patch_size, dark_channel);
+  return dark_channel;
+}
+
+void MinFilter(const cv::Mat& channel_min, const int patch_size,
+               cv::Mat& dark_channel) {
+  MinFilterCounting(channel_min, patch_size, nullptr, dark_channel);
+}
+
 cv::Mat EstimateTransmission(const cv::Mat& hazy_image,
                              const cv::Mat& atmospheric_light,
                              const int patch_size, const double omega) {
   if (patch_size % 2 == 0)
     throw std::invalid_argument(
         "EstimateTransmission(...): patch size can't be even");
-  if (hazy_image.type() != CV_64FC3)
+  if (!IsColor(hazy_image))
     throw std::invalid_argument(
         "EstimateTransmission(...): hazy_image has incorrect type");
   if (atmospheric_light.type() != CV_64FC3)
@@ -41,12 +205,45 @@ cv::Mat EstimateTransmission(const cv::Mat& hazy_image,
   if (atmospheric_light.size() != cv::Size(1, 1))
     throw std::invalid_argument(
         "EstimateTransmission(...): atmospheric_light has incorrect type");
-  cv::Mat atmospheric_light_image(hazy_image.size(), CV_64FC3,
-                                  atmospheric_light.at<cv::Scalar>(0, 0));
-  cv::Mat norm_hazy_image_by_al(hazy_image.size(), CV_64FC3);
-  cv::divide(hazy_image, atmospheric_light_image, norm_hazy_image_by_al);
-  return cv::Mat(hazy_image.size(), CV_64FC1, cv::Scalar(1.)) -
-         omega * DarkChannel(norm_hazy_image_by_al, patch_size);
+  return 1.0 - omega * MinFilter(NormalizedChannelMin(hazy_image,
+                                                     atmospheric_light),
+                                patch_size);
+}
+
+cv::Mat NormalizedChannelMin(const cv::Mat& hazy_image,
+                             const cv::Mat& atmospheric_light) {
+  cv::Mat min;
+  NormalizedChannelMin(hazy_image, atmospheric_light, min);
+  return min;
+}
+
+void NormalizedChannelMin(const cv::Mat& hazy_image,
+                          const cv::Mat& atmospheric_light, cv::Mat& min) {
+  if (!IsColor(hazy_image))
+    throw std::invalid_argument(
+        "NormalizedChannelMin(...): hazy_image has incorrect type");
+  if (atmospheric_light.type() != CV_64FC3 ||
+      atmospheric_light.size() != cv::Size(1, 1))
+    throw std::invalid_argument(
+        "NormalizedChannelMin(...): atmospheric_light has incorrect type");
+  cv::Vec3d light = atmospheric_light.at<cv::Vec3d>(0, 0);
+  if (hazy_image.depth() == CV_8U) {
+    // the division by the atmospheric light is folded into the lookup table
+    double lut[3][256];
+    for (int c = 0; c < 3; ++c)
+      for (int v = 0; v < 256; ++v) lut[c][v] = v / 255.0 / light[c];
+    ChannelMinLUT(hazy_image, lut, min);
+    return;
+  }
+  // row by row, so only one row of the quotient is kept
+  min.create(hazy_image.size(), CV_64FC1);
+  cv::Mat quotient(1, hazy_image.cols, CV_64FC3);
+  for (int i = 0; i < hazy_image.rows; ++i) {
+    cv::divide(hazy_image.row(i), cv::Scalar(light[0], light[1], light[2]),
+               quotient);
+    simd::ChannelMin(quotient.ptr<double>(), min.ptr<double>(i),
+                     hazy_image.cols);
+  }
 }
 
 cv::Mat SoftMatting(const cv::Mat& transmission, const cv::Mat& hazy_image,
@@ -79,76 +276,146 @@ cv::Mat SoftMatting(const cv::Mat& transmission, const cv::Mat& hazy_image,
       cv::Mat(transmission.size(), CV_64FC1, cv::Scalar(lambda * patch_size));
   cv::Mat result = transmission + transmission.mul(1 / (res_div * lambda));
   return result;*/
-  cv::Mat result(transmission.size(), CV_64FC1);
-  cv::boxFilter(transmission, result, -1, cv::Size(patch_size, patch_size));
+  cv::Mat result;
+  BoxFilter(transmission, patch_size, result);
   return result;
 }
 
 cv::Mat EstimateAtmospericLight(const cv::Mat& hazy_image, const int patch_size,
-                                const double brightest_share) {
+                                const double brightest_share,
+                                const AtmosphericLightMethod method) {
   if (patch_size % 2 == 0)
     throw std::invalid_argument(
         "EstimateAtmospericLight(...): patch size can't be even");
-  if (hazy_image.type() != CV_64FC3)
+  if (!IsColor(hazy_image))
     throw std::invalid_argument(
         "EstimateAtmospericLight(...): hazy_image has incorrect type");
   if (brightest_share < 0 || brightest_share > 1)
     throw std::invalid_argument(
         "EstimateAtmospericLight(...): brightest_share is out of range");
-  cv::Mat dark_channel = DarkChannel(hazy_image, patch_size);
+  if (method == QUAD_TREE) return EstimateAtmospericLightQuadTree(hazy_image);
+  if (method == DARK_CHANNEL_HISTOGRAM) {
+    std::vector<size_t> histogram;
+    cv::Mat dark_channel = DarkChannel(hazy_image, patch_size, histogram);
+    return EstimateAtmospericLight(hazy_image, dark_channel, histogram,
+                                   brightest_share);
+  }
+  return EstimateAtmospericLight(
+      hazy_image, DarkChannel(hazy_image, patch_size), brightest_share);
+}
 
-  if (dark_channel.size() != hazy_image.size())
+AtmosphericLightAccumulator::AtmosphericLightAccumulator(
+    const cv::Size& image_size, const double brightest_share) {
+  if (image_size.width <= 0 || image_size.height <= 0)
     throw std::invalid_argument(
-        "EstimateAtmospericLight(...): size of hazy_image is not equal size of "
-        "dark_channel");
+        "AtmosphericLightAccumulator::AtmosphericLightAccumulator(...): "
+        "incorrect size");
+  if (brightest_share < 0 || brightest_share > 1)
+    throw std::invalid_argument(
+        "AtmosphericLightAccumulator::AtmosphericLightAccumulator(...): "
+        "brightest_share is out of range");
+  capacity = static_cast<size_t>(std::max(
+      1.0, 1.0 * image_size.width * image_size.height * brightest_share));
+  candidates.reserve(capacity);
+}
 
-  struct coordval {
-    coordval(const int i, const int j, const double val, const cv::Vec3d& pix)
-        : i(i), j(j), val(val) {
-      intensity = pix[0] + pix[1] + pix[2];
-    }
-    int i = 0;
-    int j = 0;
-    double val;
-    double intensity;
-  };
+// the order of a stable sort by descending dark channel
+bool AtmosphericLightAccumulator::Before(const Candidate& lhs,
+                                         const Candidate& rhs) {
+  if (lhs.val != rhs.val) return lhs.val > rhs.val;
+  return lhs.i != rhs.i ? lhs.i < rhs.i : lhs.j < rhs.j;
+}
 
-  cv::Mat hazy_image_clone = hazy_image.clone();
-  std::vector<coordval> pixel_intensities;
-  pixel_intensities.reserve(dark_channel.rows * dark_channel.cols);
-  for (int i = 0; i < dark_channel.rows; ++i) {
+bool AtmosphericLightAccumulator::Accepts(const int i, const int j,
+                                          const double val) const {
+  if (candidates.size() < capacity) return true;
+  return Before({i, j, val, 0}, candidates.front());
+}
+
+double AtmosphericLightAccumulator::Bound() const {
+  if (candidates.size() < capacity)
+    return -std::numeric_limits<double>::infinity();
+  return candidates.front().val;
+}
+
+void AtmosphericLightAccumulator::Push(const Candidate& candidate) {
+  if (candidates.size() == capacity) {
+    if (!Before(candidate, candidates.front())) return;
+    std::pop_heap(candidates.begin(), candidates.end(), Before);
+    candidates.pop_back();
+  }
+  candidates.push_back(candidate);
+  std::push_heap(candidates.begin(), candidates.end(), Before);
+}
+
+void AtmosphericLightAccumulator::Add(const int i, const int j,
+                                      const double val,
+                                      const double intensity) {
+  Push({i, j, val, intensity});
+}
+
+void AtmosphericLightAccumulator::AddRows(const int i,
+                                          const cv::Mat& dark_channel,
+                                          const cv::Mat& hazy_image) {
+  if (!IsColor(hazy_image))
+    throw std::invalid_argument(
+        "AtmosphericLightAccumulator::AddRows(...): hazy_image has incorrect "
+        "type");
+  if (dark_channel.type() != CV_64FC1)
+    throw std::invalid_argument(
+        "AtmosphericLightAccumulator::AddRows(...): dark_channel has "
+        "incorrect type");
+  if (dark_channel.size() != hazy_image.size())
+    throw std::invalid_argument(
+        "AtmosphericLightAccumulator::AddRows(...): size of hazy_image is not "
+        "equal size of dark_channel");
+  for (int k = 0; k < dark_channel.rows; ++k) {
+    const double* val = dark_channel.ptr<double>(k);
     for (int j = 0; j < dark_channel.cols; ++j) {
-      pixel_intensities.emplace_back(i, j, dark_channel.at<double>(i, j),
-                                     hazy_image_clone.at<cv::Vec3d>(i, j));
+      if (!Accepts(i + k, j, val[j])) continue;
+      cv::Vec3d pixel = Pixel(hazy_image, k, j);
+      Add(i + k, j, val[j], pixel[0] + pixel[1] + pixel[2]);
     }
   }
-  std::stable_sort(pixel_intensities.begin(), pixel_intensities.end(),
-                   [](const coordval& lhs, const coordval& rhs) {
-                     return lhs.val > rhs.val;
-                   });
-  int border = static_cast<int>(
-      std::max(1.0, 1.0 * pixel_intensities.size() * brightest_share));
-  cv::Scalar atmospheric_light_val(0, 0, 0);
+}
+
+void AtmosphericLightAccumulator::Merge(
+    const AtmosphericLightAccumulator& other) {
+  if (other.capacity != capacity)
+    throw std::invalid_argument(
+        "AtmosphericLightAccumulator::Merge(...): accumulators of different "
+        "images");
+  for (const auto& candidate : other.candidates) Push(candidate);
+}
+
+// Averages the brightest pixels among the ones with the largest dark channel.
+cv::Mat AtmosphericLightAccumulator::Light(
+    const std::function<cv::Vec3d(const int, const int)>& color_at) const {
   auto comp_float = [](const double lhs, const double rhs) -> bool {
     double max = std::max({fabs(lhs), fabs(rhs), 1.0});
     if (fabs(rhs - lhs) < max * std::numeric_limits<double>::epsilon())
       return true;
     return false;
   };
-  int al_num = 0;
   double max_intensity = 0;
-  for (int i = 0; i < border; ++i) {
-    auto& coords = pixel_intensities[i];
-    if (max_intensity < coords.intensity) max_intensity = coords.intensity;
-  }
-  for (int i = 0; i < border; ++i) {
-    auto& coords = pixel_intensities[i];
-    if (comp_float(max_intensity, coords.intensity)) {
-      atmospheric_light_val +=
-          hazy_image_clone.at<cv::Scalar>(coords.i, coords.j);
-      ++al_num;
-    }
+  for (const auto& candidate : candidates)
+    if (max_intensity < candidate.intensity)
+      max_intensity = candidate.intensity;
+  // only the brightest are sorted, into the order of the rows
+  std::vector<cv::Point> brightest;
+  for (const auto& candidate : candidates)
+    if (comp_float(max_intensity, candidate.intensity))
+      brightest.emplace_back(candidate.j, candidate.i);
+  std::sort(brightest.begin(), brightest.end(),
+            [](const cv::Point& lhs, const cv::Point& rhs) {
+              return lhs.y != rhs.y ? lhs.y < rhs.y : lhs.x < rhs.x;
+            });
+  cv::Scalar atmospheric_light_val(0, 0, 0);
+  for (const auto& point : brightest) {
+    cv::Vec3d pixel = color_at(point.y, point.x);
+    atmospheric_light_val += cv::Scalar(pixel[0], pixel[1], pixel[2]);
   }
+  int al_num = static_cast<int>(brightest.size());
   if (al_num == 0)
     throw std::runtime_error(
         "EstimateAtmospericLight(...): must be at least one pixel with max "
@@ -158,4 +425,364 @@ cv::Mat EstimateAtmospericLight(const cv::Mat& hazy_image, const int patch_size,
   return atmospheric_light;
 }
 
+cv::Mat AtmosphericLightAccumulator::Light(const cv::Mat& hazy_image) const {
+  if (!IsColor(hazy_image))
+    throw std::invalid_argument(
+        "AtmosphericLightAccumulator::Light(...): hazy_image has incorrect "
+        "type");
+  return Light([&](const int i, const int j) {
+    return Pixel(hazy_image, i, j);
+  });
+}
+
+// row_intensity(i, out) writes the sums of colors of row i, pixel_at(i, j)
+// returns a color; the color is read only for the averaged pixels.
+template <typename RowIntensity, typename PixelAt>
+static cv::Mat SelectAtmosphericLight(const cv::Mat& dark_channel,
+                                      const double brightest_share,
+                                      RowIntensity row_intensity,
+                                      PixelAt pixel_at) {
+  AtmosphericLightAccumulator accumulator(dark_channel.size(),
+                                          brightest_share);
+  std::vector<double> intensities(dark_channel.cols);
+  for (int i = 0; i < dark_channel.rows; ++i) {
+    row_intensity(i, intensities.data());
+    const double* val = dark_channel.ptr<double>(i);
+    for (int j = 0; j < dark_channel.cols; ++j)
+      if (accumulator.Accepts(i, j, val[j]))
+        accumulator.Add(i, j, val[j], intensities[j]);
+  }
+  return accumulator.Light(pixel_at);
+}
+
+// The brightest_share-th largest value of the dark channel is in the bin of
+// the threshold, so only the pixels at and above it are gathered, in one pass.
+template <typename PixelAt>
+static cv::Mat GatherAtmosphericLight(const cv::Mat& dark_channel,
+                                      const std::vector<size_t>& histogram,
+                                      const double brightest_share,
+                                      PixelAt pixel_at) {
+  if (histogram.size() != static_cast<size_t>(dark_channel_bins))
+    throw std::invalid_argument(
+        "EstimateAtmospericLight(...): histogram has incorrect size");
+  AtmosphericLightAccumulator accumulator(dark_channel.size(),
+                                          brightest_share);
+  int threshold = dark_channel_bins - 1;
+  for (size_t above = 0;
+       threshold > 0 && above + histogram[threshold] < accumulator.Capacity();
+       --threshold)
+    above += histogram[threshold];
+  for (int i = 0; i < dark_channel.rows; ++i) {
+    const double* val = dark_channel.ptr<double>(i);
+    for (int j = 0; j < dark_channel.cols; ++j) {
+      if (DarkChannelBin(val[j]) < threshold) continue;
+      cv::Vec3d pixel = pixel_at(i, j);
+      accumulator.Add(i, j, val[j], pixel[0] + pixel[1] + pixel[2]);
+    }
+  }
+  return accumulator.Light(pixel_at);
+}
+
+cv::Mat EstimateAtmospericLight(const cv::Mat& hazy_image,
+                                const cv::Mat& dark_channel,
+                                const std::vector<size_t>& histogram,
+                                const double brightest_share) {
+  if (!IsColor(hazy_image))
+    throw std::invalid_argument(
+        "EstimateAtmospericLight(...): hazy_image has incorrect type");
+  if (brightest_share < 0 || brightest_share > 1)
+    throw std::invalid_argument(
+        "EstimateAtmospericLight(...): brightest_share is out of range");
+  if (dark_channel.type() != CV_64FC1)
+    throw std::invalid_argument(
+        "EstimateAtmospericLight(...): dark_channel has incorrect type");
+  if (dark_channel.size() != hazy_image.size())
+    throw std::invalid_argument(
+        "EstimateAtmospericLight(...): size of hazy_image is not equal size of "
+        "dark_channel");
+  return GatherAtmosphericLight(
+      dark_channel, histogram, brightest_share,
+      [&](const int i, const int j) { return Pixel(hazy_image, i, j); });
+}
+
+cv::Mat EstimateAtmospericLight(const cv::Mat& hazy_image,
+                                const cv::Mat& dark_channel,
+                                const double brightest_share) {
+  if (!IsColor(hazy_image))
+    throw std::invalid_argument(
+        "EstimateAtmospericLight(...): hazy_image has incorrect type");
+  if (dark_channel.type() != CV_64FC1)
+    throw std::invalid_argument(
+        "EstimateAtmospericLight(...): dark_channel has incorrect type");
+  if (brightest_share < 0 || brightest_share > 1)
+    throw std::invalid_argument(
+        "EstimateAtmospericLight(...): brightest_share is out of range");
+
+  if (dark_channel.size() != hazy_image.size())
+    throw std::invalid_argument(
+        "EstimateAtmospericLight(...): size of hazy_image is not equal size of "
+        "dark_channel");
+  return SelectAtmosphericLight(
+      dark_channel, brightest_share,
+      [&](const int i, double* intensities) {
+        if (hazy_image.depth() == CV_64F) {
+          simd::Intensity(hazy_image.ptr<double>(i), intensities,
+                          hazy_image.cols);
+          return;
+        }
+        for (int j = 0; j < hazy_image.cols; ++j) {
+          cv::Vec3d pixel = Pixel(hazy_image, i, j);
+          intensities[j] = pixel[0] + pixel[1] + pixel[2];
+        }
+      },
+      [&](const int i, const int j) { return Pixel(hazy_image, i, j); });
+}
+
+// sum and sqsum are tables of a CV_64FC3 image in [0, 1] and of its
+// squares; pixel_at(i, j) returns a color.
+template <typename PixelAt>
+static cv::Mat SelectQuadTree(const sat::Table& sum, const sat::Table& sqsum,
+                              const int region_size, PixelAt pixel_at) {
+  auto score = [&](const cv::Rect& r) {
+    cv::Scalar s = sum.Sum(r);
+    cv::Scalar sq = sqsum.Sum(r);
+    double n = 3.0 * r.area();
+    double mean = (s[0] + s[1] + s[2]) / n;
+    double variance = (sq[0] + sq[1] + sq[2]) / n - mean * mean;
+    return mean - std::sqrt(std::max(variance, 0.0));
+  };
+  cv::Rect region(cv::Point(0, 0), sum.Size());
+  while ((region.width > region_size || region.height > region_size) &&
+         region.width > 1 && region.height > 1) {
+    int width = region.width / 2;
+    int height = region.height / 2;
+    cv::Rect quadrants[4] = {
+        {region.x, region.y, width, height},
+        {region.x + width, region.y, region.width - width, height},
+        {region.x, region.y + height, width, region.height - height},
+        {region.x + width, region.y + height, region.width - width,
+         region.height - height}};
+    double best = score(quadrants[0]);
+    region = quadrants[0];
+    for (int q = 1; q < 4; ++q) {
+      double quadrant_score = score(quadrants[q]);
+      if (quadrant_score > best) {
+        best = quadrant_score;
+        region = quadrants[q];
+      }
+    }
+  }
+  cv::Vec3d light = pixel_at(region.y, region.x);
+  double min_distance = std::numeric_limits<double>::infinity();
+  for (int i = region.y; i < region.y + region.height; ++i)
+    for (int j = region.x; j < region.x + region.width; ++j) {
+      cv::Vec3d pixel = pixel_at(i, j);
+      double distance = (1 - pixel[0]) * (1 - pixel[0]) +
+                        (1 - pixel[1]) * (1 - pixel[1]) +
+                        (1 - pixel[2]) * (1 - pixel[2]);
+      if (distance < min_distance) {
+        min_distance = distance;
+        light = pixel;
+      }
+    }
+  return cv::Mat(1, 1, CV_64FC3, cv::Scalar(light[0], light[1], light[2]));
+}
+
+cv::Mat EstimateAtmospericLightQuadTree(const cv::Mat& hazy_image,
+                                        const int region_size) {
+  if (!IsColor(hazy_image))
+    throw std::invalid_argument(
+        "EstimateAtmospericLightQuadTree(...): hazy_image has incorrect type");
+  if (region_size < 1)
+    throw std::invalid_argument(
+        "EstimateAtmospericLightQuadTree(...): region_size must be positive");
+  cv::Mat image;
+  hazy_image.convertTo(image, CV_64FC3,
+                      hazy_image.depth() == CV_8U ? 1.0 / 255.0 : 1.0);
+  return SelectQuadTree(
+      sat::Table(image), sat::Table(image.mul(image)), region_size,
+      [&](const int i, const int j) { return Pixel(hazy_image, i, j); });
+}
+
+static cv::Mat GuidedUpsampleGray(const cv::Mat& transmission,
+                                  const cv::Mat& low_gray,
+                                  const cv::Mat& gray, const int radius,
+                                  const double eps) {
+  // fast guided filter: the linear coefficients are fitted at low resolution
+  // and only they are upsampled, so the edges come from the full-size guide
+  cv::Mat mean_i = Box(low_gray, radius);
+  cv::Mat mean_p = Box(transmission, radius);
+  cv::Mat var_i = Box(low_gray.mul(low_gray), radius) - mean_i.mul(mean_i);
+  cv::Mat cov_ip =
+      Box(low_gray.mul(transmission), radius) - mean_i.mul(mean_p);
+  cv::Mat a = cov_ip / (var_i + eps);
+  cv::Mat b = mean_p - a.mul(mean_i);
+  cv::Mat mean_a;
+  cv::Mat mean_b;
+  cv::resize(Box(a, radius), mean_a, gray.size(), 0, 0, cv::INTER_LINEAR);
+  cv::resize(Box(b, radius), mean_b, gray.size(), 0, 0, cv::INTER_LINEAR);
+  return mean_a.mul(gray) + mean_b;
+}
+
+cv::Mat GuidedUpsample(const cv::Mat& transmission, const cv::Mat& low_guide,
+                       const cv::Mat& guide, const int radius,
+                       const double eps) {
+  if (transmission.type() != CV_64FC1)
+    throw std::invalid_argument(
+        "GuidedUpsample(...): transmission has incorrect type");
+  if (low_guide.type() != CV_64FC3 || guide.type() != CV_64FC3)
+    throw std::invalid_argument(
+        "GuidedUpsample(...): guide has incorrect type");
+  if (transmission.size() != low_guide.size())
+    throw std::invalid_argument(
+        "GuidedUpsample(...): size of transmission is not equal size of "
+        "low_guide");
+  if (radius < 1)
+    throw std::invalid_argument("GuidedUpsample(...): radius must be positive");
+  return GuidedUpsampleGray(transmission, Gray(low_guide), Gray(guide),
+                            radius, eps);
+}
+
+static void CheckPlanar(const planar::Image& image, const std::string& name) {
+  if (image.Channels() != 3)
+    throw std::invalid_argument(name + "(...): image has incorrect type");
+}
+
+static cv::Mat Gray(const planar::Image& image) {
+  return (image.Plane(0) + image.Plane(1) + image.Plane(2)) / 3.0;
+}
+
+cv::Mat ChannelMin(const planar::Image& image) {
+  CheckPlanar(image, "ChannelMin");
+  cv::Mat min(image.Size(), CV_64FC1);
+  for (int i = 0; i < image.Rows(); ++i) {
+    double* dst = min.ptr<double>(i);
+    simd::Min(image.Row(0, i), image.Row(1, i), dst, image.Cols());
+    simd::Min(dst, image.Row(2, i), dst, image.Cols());
+  }
+  return min;
+}
+
+cv::Mat DarkChannel(const planar::Image& image, const int patch_size) {
+  if (patch_size % 2 == 0)
+    throw std::invalid_argument("DarkChannel(...): patch size can't be even");
+  return MinFilter(ChannelMin(image), patch_size);
+}
+
+cv::Mat DarkChannel(const planar::Image& image, const int patch_size,
+                    std::vector<size_t>& histogram) {
+  if (patch_size % 2 == 0)
+    throw std::invalid_argument("DarkChannel(...): patch size can't be even");
+  cv::Mat channel_min = ChannelMin(image);
+  histogram.assign(dark_channel_bins, 0);
+  cv::Mat dark_channel;
+  MinFilterCounting(channel_min, patch_size, &histogram, dark_channel);
+  return dark_channel;
+}
+
+cv::Mat EstimateTransmission(const planar::Image& hazy_image,
+                             const cv::Mat& atmospheric_light,
+                             const int patch_size, const double omega) {
+  if (patch_size % 2 == 0)
+    throw std::invalid_argument(
+        "EstimateTransmission(...): patch size can't be even");
+  CheckPlanar(hazy_image, "EstimateTransmission");
+  if (atmospheric_light.type() != CV_64FC3 ||
+      atmospheric_light.size() != cv::Size(1, 1))
+    throw std::invalid_argument(
+        "EstimateTransmission(...): atmospheric_light has incorrect type");
+  cv::Vec3d light = atmospheric_light.at<cv::Vec3d>(0, 0);
+  cv::Mat min(hazy_image.Size(), CV_64FC1,
+              cv::Scalar(std::numeric_limits<double>::infinity()));
+  for (int i = 0; i < hazy_image.Rows(); ++i)
+    for (int c = 0; c < 3; ++c)
+      simd::MinQuotient(hazy_image.Row(c, i), light[c], min.ptr<double>(i),
+                        hazy_image.Cols());
+  return 1.0 - omega * MinFilter(min, patch_size);
+}
+
+cv::Mat EstimateAtmospericLight(const planar::Image& hazy_image,
+                                const cv::Mat& dark_channel,
+                                const double brightest_share) {
+  CheckPlanar(hazy_image, "EstimateAtmospericLight");
+  if (dark_channel.type() != CV_64FC1)
+    throw std::invalid_argument(
+        "EstimateAtmospericLight(...): dark_channel has incorrect type");
+  if (brightest_share < 0 || brightest_share > 1)
+    throw std::invalid_argument(
+        "EstimateAtmospericLight(...): brightest_share is out of range");
+  if (dark_channel.size() != hazy_image.Size())
+    throw std::invalid_argument(
+        "EstimateAtmospericLight(...): size of hazy_image is not equal size of "
+        "dark_channel");
+  return SelectAtmosphericLight(
+      dark_channel, brightest_share,
+      [&](const int i, double* intensities) {
+        simd::Sum3(hazy_image.Row(0, i), hazy_image.Row(1, i),
+                   hazy_image.Row(2, i), intensities, hazy_image.Cols());
+      },
+      [&](const int i, const int j) {
+        return cv::Vec3d(hazy_image.Row(0, i)[j], hazy_image.Row(1, i)[j],
+                         hazy_image.Row(2, i)[j]);
+      });
+}
+
+cv::Mat EstimateAtmospericLight(const planar::Image& hazy_image,
+                                const cv::Mat& dark_channel,
+                                const std::vector<size_t>& histogram,
+                                const double brightest_share) {
+  CheckPlanar(hazy_image, "EstimateAtmospericLight");
+  if (brightest_share < 0 || brightest_share > 1)
+    throw std::invalid_argument(
+        "EstimateAtmospericLight(...): brightest_share is out of range");
+  if (dark_channel.type() != CV_64FC1)
+    throw std::invalid_argument(
+        "EstimateAtmospericLight(...): dark_channel has incorrect type");
+  if (dark_channel.size() != hazy_image.Size())
+    throw std::invalid_argument(
+        "EstimateAtmospericLight(...): size of hazy_image is not equal size of "
+        "dark_channel");
+  return GatherAtmosphericLight(
+      dark_channel, histogram, brightest_share, [&](const int i, const int j) {
+        return cv::Vec3d(hazy_image.Row(0, i)[j], hazy_image.Row(1, i)[j],
+                         hazy_image.Row(2, i)[j]);
+      });
+}
+
+cv::Mat EstimateAtmospericLightQuadTree(const planar::Image& hazy_image,
+                                        const int region_size) {
+  CheckPlanar(hazy_image, "EstimateAtmospericLightQuadTree");
+  if (region_size < 1)
+    throw std::invalid_argument(
+        "EstimateAtmospericLightQuadTree(...): region_size must be positive");
+  cv::Mat image = hazy_image.ToMat();
+  return SelectQuadTree(sat::Table(image), sat::Table(image.mul(image)),
+                        region_size,
+                        [&](const int i, const int j) {
+                          return cv::Vec3d(hazy_image.Row(0, i)[j],
+                                           hazy_image.Row(1, i)[j],
+                                           hazy_image.Row(2, i)[j]);
+                        });
+}
+
+cv::Mat GuidedUpsample(const cv::Mat& transmission,
+                       const planar::Image& low_guide,
+                       const planar::Image& guide, const int radius,
+                       const double eps) {
+  if (transmission.type() != CV_64FC1)
+    throw std::invalid_argument(
+        "GuidedUpsample(...): transmission has incorrect type");
+  if (low_guide.Channels() != 3 || guide.Channels() != 3)
+    throw std::invalid_argument(
+        "GuidedUpsample(...): guide has incorrect type");
+  if (transmission.size() != low_guide.Size())
+    throw std::invalid_argument(
+        "GuidedUpsample(...): size of transmission is not equal size of "
+        "low_guide");
+  if (radius < 1)
+    throw std::invalid_argument("GuidedUpsample(...): radius must be positive");
+  return GuidedUpsampleGray(transmission, Gray(low_guide), Gray(guide),
+                            radius, eps);
+}
+
 }  // namespace dcp
@@ -3,21 +3,185 @@
 #define DCP_HPP
 
 #include <opencv2/core/mat.hpp>
+#include <cstddef>
+#include <functional>
+#include <planar/planar.hpp>
+#include <string>
+#include <vector>
 
 namespace dcp {
 
+// How EstimateAtmospericLight finds the brightest_share pixels with the
+// largest dark channel: TOP_DARK_CHANNEL keeps them in a heap while scanning
+// all pixels, DARK_CHANNEL_HISTOGRAM counts a histogram of the dark channel
+// while computing it and gathers only the pixels at and above the bin of the
+// threshold. Both average the same pixels. QUAD_TREE doesn't look at the dark
+// channel, see EstimateAtmospericLightQuadTree.
+enum AtmosphericLightMethod {
+  TOP_DARK_CHANNEL,
+  DARK_CHANNEL_HISTOGRAM,
+  QUAD_TREE
+};
+
+AtmosphericLightMethod ParseAtmosphericLightMethod(const std::string& name);
+
+// bins of the dark channel histogram over [0, 1], values out of the range
+// fall into the end bins
+const int dark_channel_bins = 4096;
+
 cv::Mat SoftMatting(const cv::Mat& transmission, const cv::Mat& hazy_image,
                     const int patch_size, const double eps,
                     const double lambda = 1e-4);
 
+// Color images are CV_64FC3 in [0, 1] or CV_8UC3; 8-bit pixels are unpacked
+// by a lookup table inside the per-pixel loops of DarkChannel, ChannelMin,
+// EstimateTransmission and EstimateAtmospericLight, so the caller doesn't
+// need a converted copy of the image.
 cv::Mat DarkChannel(const cv::Mat& image, const int patch_size);
 
+// the same also counting the values into histogram of dark_channel_bins bins
+cv::Mat DarkChannel(const cv::Mat& image, const int patch_size,
+                    std::vector<size_t>& histogram);
+
+// DarkChannel split in two stages, so the per-pixel minimum over colors can be
+// shared by several patch sizes.
+cv::Mat ChannelMin(const cv::Mat& image);
+
+cv::Mat MinFilter(const cv::Mat& channel_min, const int patch_size);
+
+// Forms of the stages writing into a given matrix, which is reallocated only
+// if it hasn't the size and type of the result, so a view into a larger
+// buffer (a band of rows, an image of a batch) is filled in place. The result
+// can't share data with the input.
+void ChannelMin(const cv::Mat& image, cv::Mat& min);
+
+void MinFilter(const cv::Mat& channel_min, const int patch_size,
+               cv::Mat& dark_channel);
+
+void NormalizedChannelMin(const cv::Mat& hazy_image,
+                          const cv::Mat& atmospheric_light, cv::Mat& min);
+
+// cv::boxFilter with the default reflect-101 border, the filter SoftMatting
+// applies to the transmission
+void BoxFilter(const cv::Mat& image, const int ksize, cv::Mat& result);
+
 cv::Mat EstimateTransmission(const cv::Mat& hazy_image,
                              const cv::Mat& atmospheric_light,
                              const int patch_size, const double omega = 0.95);
 
-cv::Mat EstimateAtmospericLight(const cv::Mat& hazy_image, const int patch_size,
-                                const double brightest_share = 1e-3);
+// min over colors of hazy_image / atmospheric_light, the image that
+// EstimateTransmission filters; it's computed per pixel, so a band of rows
+// gives the same values as the whole image
+cv::Mat NormalizedChannelMin(const cv::Mat& hazy_image,
+                             const cv::Mat& atmospheric_light);
+
+cv::Mat EstimateAtmospericLight(
+    const cv::Mat& hazy_image, const int patch_size,
+    const double brightest_share = 1e-3,
+    const AtmosphericLightMethod method = TOP_DARK_CHANNEL);
+
+// the same with the dark channel of hazy_image computed by the caller
+cv::Mat EstimateAtmospericLight(const cv::Mat& hazy_image,
+                                const cv::Mat& dark_channel,
+                                const double brightest_share);
+
+// DARK_CHANNEL_HISTOGRAM with the histogram counted by DarkChannel
+cv::Mat EstimateAtmospericLight(const cv::Mat& hazy_image,
+                                const cv::Mat& dark_channel,
+                                const std::vector<size_t>& histogram,
+                                const double brightest_share);
+
+// Hierarchical search of Kim et al.: of the four quadrants the one with the
+// largest mean minus standard deviation of its color values is split again
+// until both sides are at most region_size, and the pixel of the last one
+// closest to white is the light. Bright flat haze wins over white objects,
+// which bring texture around them. The window statistics come from integral
+// images, so each pixel is read once.
+cv::Mat EstimateAtmospericLightQuadTree(const cv::Mat& hazy_image,
+                                        const int region_size = 32);
+
+// Color of pixel (i, j) of a CV_8UC3 or CV_64FC3 image, in [0, 1].
+cv::Vec3d Pixel(const cv::Mat& image, const int i, const int j);
+
+// Streaming form of the selection made by EstimateAtmospericLight: only the
+// brightest_share pixels with the largest dark channel are kept, so rows may
+// come in bands and in any order, and accumulators of disjoint parts of the
+// image can be merged. A pixel is kept as its position, dark channel and
+// intensity; colors are read by Light only for the pixels it averages. Light
+// equals EstimateAtmospericLight on the whole image.
+class AtmosphericLightAccumulator {
+ public:
+  AtmosphericLightAccumulator(const cv::Size& image_size,
+                              const double brightest_share);
+  // whether the pixel would be kept now, so its intensity isn't computed
+  // otherwise
+  bool Accepts(const int i, const int j, const double val) const;
+  // pixels with a dark channel below the bound are never kept again; it only
+  // grows, so rows may be filtered against an older bound
+  double Bound() const;
+  void Add(const int i, const int j, const double val,
+           const double intensity);
+  // rows of the dark channel and of the image, the first one is image row i
+  void AddRows(const int i, const cv::Mat& dark_channel,
+               const cv::Mat& hazy_image);
+  void Merge(const AtmosphericLightAccumulator& other);
+  // averages color_at(i, j) of the kept pixels of the largest intensity,
+  // which is called for them in row-major order
+  cv::Mat Light(
+      const std::function<cv::Vec3d(const int, const int)>& color_at) const;
+  // the same for the rows added from hazy_image
+  cv::Mat Light(const cv::Mat& hazy_image) const;
+  // number of the kept pixels
+  size_t Capacity() const { return capacity; }
+
+ private:
+  struct Candidate {
+    int i;
+    int j;
+    double val;
+    double intensity;
+  };
+  static bool Before(const Candidate& lhs, const Candidate& rhs);
+  void Push(const Candidate& candidate);
+
+  size_t capacity = 1;
+  // a heap with the last kept candidate on top
+  std::vector<Candidate> candidates;
+};
+
+cv::Mat GuidedUpsample(const cv::Mat& transmission, const cv::Mat& low_guide,
+                       const cv::Mat& guide, const int radius,
+                       const double eps = 1e-3);
+
+// Overloads for planar three-channel images in [0, 1]: the kernels run over
+// contiguous planes and give the same results as for the interleaved image.
+cv::Mat ChannelMin(const planar::Image& image);
+
+cv::Mat DarkChannel(const planar::Image& image, const int patch_size);
+
+cv::Mat DarkChannel(const planar::Image& image, const int patch_size,
+                    std::vector<size_t>& histogram);
+
+cv::Mat EstimateTransmission(const planar::Image& hazy_image,
+                             const cv::Mat& atmospheric_light,
+                             const int patch_size, const double omega = 0.95);
+
+cv::Mat EstimateAtmospericLight(const planar::Image& hazy_image,
+                                const cv::Mat& dark_channel,
+                                const double brightest_share);
+
+cv::Mat EstimateAtmospericLight(const planar::Image& hazy_image,
+                                const cv::Mat& dark_channel,
+                                const std::vector<size_t>& histogram,
+                                const double brightest_share);
+
+cv::Mat EstimateAtmospericLightQuadTree(const planar::Image& hazy_image,
+                                        const int region_size = 32);
+
+cv::Mat GuidedUpsample(const cv::Mat& transmission,
+                       const planar::Image& low_guide,
+                       const planar::Image& guide, const int radius,
+                       const double eps = 1e-3);
 
 }  // namespace dcp
 #endif  // DCP_HPP
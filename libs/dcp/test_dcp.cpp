@@ -4,6 +4,8 @@
 #include <dcp.hpp>
 #include <opencv2/core.hpp>
 #include <opencv2/core/mat.hpp>
+#include <opencv2/imgproc.hpp>
+#include <vector>
 
 static bool IsDoubleMatsEqual(const cv::Mat& lhs, const cv::Mat& rhs) {
   // (hypothesis) it seems that in OpenCV cv::compare is breaked for zero filled
@@ -80,4 +82,265 @@ TEST_CASE("EstimateAtmospericLight") {
   for (int i = 0; i < 3; ++i) {
     CHECK_EQ(doctest::Approx(atm_light.at<cv::Vec3d>(0, 0)[i]), 1.0);
   }
+  cv::Mat shared = dcp::EstimateAtmospericLight(
+      test, dcp::MinFilter(dcp::ChannelMin(test), 3), 1e-3);
+  CHECK(IsDoubleMatsEqual(shared.reshape(1), atm_light.reshape(1)));
+}
+
+TEST_CASE("GuidedUpsample") {
+  cv::Mat low_guide(4, 6, CV_64FC3, cv::Scalar(0.2, 0.4, 0.6));
+  cv::Mat guide(16, 24, CV_64FC3, cv::Scalar(0.2, 0.4, 0.6));
+  cv::Mat transmission(4, 6, CV_64FC1, cv::Scalar(0.7));
+  REQUIRE_THROWS_WITH_AS(
+      dcp::GuidedUpsample(transmission, guide, guide, 1),
+      "GuidedUpsample(...): size of transmission is not equal size of "
+      "low_guide",
+      const std::invalid_argument&);
+  REQUIRE_THROWS_WITH_AS(dcp::GuidedUpsample(transmission, low_guide, guide, 0),
+                         "GuidedUpsample(...): radius must be positive",
+                         const std::invalid_argument&);
+  cv::Mat upsampled = dcp::GuidedUpsample(transmission, low_guide, guide, 1);
+  CHECK_EQ(upsampled.size(), guide.size());
+  cv::Mat ideal(guide.size(), CV_64FC1, cv::Scalar(0.7));
+  CHECK_LT(cv::norm(upsampled, ideal, cv::NORM_INF), 1e-12);
+}
+
+TEST_CASE("8-bit input") {
+  cv::Mat packed(12, 10, CV_8UC3);
+  cv::randu(packed, cv::Scalar::all(0), cv::Scalar::all(256));
+  cv::Mat image;
+  packed.convertTo(image, CV_64FC3, 1.0 / 255.0);
+  CHECK(IsDoubleMatsEqual(dcp::ChannelMin(packed), dcp::ChannelMin(image)));
+  CHECK(IsDoubleMatsEqual(dcp::DarkChannel(packed, 3),
+                          dcp::DarkChannel(image, 3)));
+  cv::Mat light = dcp::EstimateAtmospericLight(image, 3, 0.1);
+  cv::Mat packed_light = dcp::EstimateAtmospericLight(packed, 3, 0.1);
+  CHECK(cv::norm(light, packed_light, cv::NORM_INF) < 1e-12);
+  cv::Mat transmission = dcp::EstimateTransmission(image, light, 3);
+  cv::Mat packed_transmission = dcp::EstimateTransmission(packed, light, 3);
+  CHECK(cv::norm(transmission, packed_transmission, cv::NORM_INF) < 1e-12);
+}
+
+TEST_CASE("AtmosphericLightAccumulator") {
+  cv::Mat image(40, 30, CV_8UC3);
+  cv::randu(image, cv::Scalar::all(0), cv::Scalar::all(256));
+  // ties of the dark channel are broken by the position of the pixel
+  image.rowRange(5, 9).setTo(cv::Scalar(250, 240, 230));
+  image.rowRange(30, 32).setTo(cv::Scalar(240, 250, 230));
+  cv::Mat dark_channel = dcp::DarkChannel(image, 5);
+  cv::Mat light = dcp::EstimateAtmospericLight(image, dark_channel, 0.02);
+
+  dcp::AtmosphericLightAccumulator reversed(image.size(), 0.02);
+  for (int i = image.rows - 1; i >= 0; --i)
+    reversed.AddRows(i, dark_channel.row(i), image.row(i));
+  CHECK_EQ(cv::norm(reversed.Light(image), light, cv::NORM_INF), 0);
+
+  dcp::AtmosphericLightAccumulator top(image.size(), 0.02);
+  dcp::AtmosphericLightAccumulator bottom(image.size(), 0.02);
+  bottom.AddRows(17, dark_channel.rowRange(17, 40), image.rowRange(17, 40));
+  top.AddRows(0, dark_channel.rowRange(0, 17), image.rowRange(0, 17));
+  top.Merge(bottom);
+  CHECK_EQ(cv::norm(top.Light(image), light, cv::NORM_INF), 0);
+  CHECK_EQ(top.Bound(), reversed.Bound());
+  CHECK_FALSE(top.Accepts(0, 0, top.Bound() - 1e-9));
+
+  // colors are read only for the averaged pixels, row by row
+  std::vector<cv::Point> read;
+  cv::Mat gathered = top.Light([&](const int i, const int j) {
+    read.emplace_back(j, i);
+    return dcp::Pixel(image, i, j);
+  });
+  CHECK_EQ(cv::norm(gathered, light, cv::NORM_INF), 0);
+  REQUIRE_FALSE(read.empty());
+  CHECK_LE(read.size(), 6 * 30);
+  for (size_t k = 1; k < read.size(); ++k)
+    CHECK(read[k - 1].y * 30 + read[k - 1].x < read[k].y * 30 + read[k].x);
+
+  CHECK_THROWS_WITH_AS(
+      top.Merge(dcp::AtmosphericLightAccumulator(cv::Size(3, 3), 0.02)),
+      "AtmosphericLightAccumulator::Merge(...): accumulators of different "
+      "images",
+      const std::invalid_argument&);
+  CHECK_THROWS_WITH_AS(
+      top.AddRows(0, dark_channel.row(0), image.rowRange(0, 2)),
+      "AtmosphericLightAccumulator::AddRows(...): size of hazy_image is not "
+      "equal size of dark_channel",
+      const std::invalid_argument&);
+}
+
+TEST_CASE("filters match OpenCV") {
+  cv::Mat channel_min(23, 31, CV_64FC1);
+  cv::randu(channel_min, cv::Scalar(0), cv::Scalar(1));
+  for (int patch_size : {1, 3, 7, 15, 51}) {
+    CAPTURE(patch_size);
+    cv::Mat ideal;
+    cv::erode(channel_min, ideal,
+              cv::getStructuringElement(cv::MORPH_RECT,
+                                        cv::Size(patch_size, patch_size)),
+              cv::Point(-1, -1), 1, cv::BORDER_REPLICATE);
+    CHECK(cv::norm(dcp::MinFilter(channel_min, patch_size), ideal,
+                   cv::NORM_INF) == 0);
+  }
+  cv::Mat image(23, 31, CV_64FC3);
+  for (int patch_size : {2, 5, 9}) {
+    CAPTURE(patch_size);
+    cv::Mat ideal;
+    cv::boxFilter(channel_min, ideal, -1, cv::Size(patch_size, patch_size));
+    CHECK(cv::norm(dcp::SoftMatting(channel_min, image, patch_size, 0.01),
+                   ideal, cv::NORM_INF) < 1e-12);
+  }
+}
+
+TEST_CASE("output forms fill views in place") {
+  cv::Mat image(23, 31, CV_8UC3);
+  cv::randu(image, cv::Scalar::all(0), cv::Scalar::all(256));
+  cv::Mat light(1, 1, CV_64FC3, cv::Scalar(0.9, 0.8, 0.7));
+  // two images stacked as in a batch, the second one is written
+  cv::Mat stack(46, 31, CV_64FC1, cv::Scalar(-1));
+  cv::Mat view = stack.rowRange(23, 46);
+  const double* data = view.ptr<double>();
+  dcp::ChannelMin(image, view);
+  CHECK_EQ(view.ptr<double>(), data);
+  CHECK_EQ(cv::norm(view, dcp::ChannelMin(image), cv::NORM_INF), 0);
+  cv::Mat min = dcp::ChannelMin(image);
+  dcp::MinFilter(min, 5, view);
+  CHECK_EQ(view.ptr<double>(), data);
+  CHECK_EQ(cv::norm(view, dcp::MinFilter(min, 5), cv::NORM_INF), 0);
+  cv::Mat unpacked;
+  image.convertTo(unpacked, CV_64FC3, 1.0 / 255.0);
+  for (const cv::Mat& hazy_image : {image, unpacked}) {
+    dcp::NormalizedChannelMin(hazy_image, light, view);
+    CHECK_EQ(view.ptr<double>(), data);
+    CHECK_EQ(cv::norm(view, dcp::NormalizedChannelMin(hazy_image, light),
+                      cv::NORM_INF),
+             0);
+  }
+  dcp::BoxFilter(min, 9, view);
+  CHECK_EQ(view.ptr<double>(), data);
+  CHECK_EQ(cv::norm(view, dcp::SoftMatting(min, image, 9, 0.01),
+                    cv::NORM_INF),
+           0);
+  // the first image is untouched
+  CHECK_EQ(cv::norm(stack.rowRange(0, 23),
+                    cv::Mat(23, 31, CV_64FC1, cv::Scalar(-1)), cv::NORM_INF),
+           0);
+}
+
+TEST_CASE("histogram atmospheric light") {
+  cv::Mat packed(33, 45, CV_8UC3);
+  cv::randu(packed, cv::Scalar::all(0), cv::Scalar::all(256));
+  // a plateau wider than the share, so the threshold bin is split by ties
+  packed.rowRange(3, 8).setTo(cv::Scalar(240, 235, 250));
+  cv::Mat image;
+  packed.convertTo(image, CV_64FC3, 1.0 / 255.0);
+  planar::Image planar_image(image);
+  for (double share : {0.0, 1e-3, 0.05, 0.5, 1.0}) {
+    CHECK_EQ(cv::norm(dcp::EstimateAtmospericLight(
+                          packed, 5, share, dcp::DARK_CHANNEL_HISTOGRAM),
+                      dcp::EstimateAtmospericLight(packed, 5, share),
+                      cv::NORM_INF),
+             0);
+    std::vector<size_t> histogram;
+    cv::Mat dark_channel = dcp::DarkChannel(image, 5, histogram);
+    CHECK_EQ(cv::norm(dark_channel, dcp::DarkChannel(image, 5), cv::NORM_INF),
+             0);
+    size_t total = 0;
+    for (size_t count : histogram) total += count;
+    CHECK_EQ(total, dark_channel.total());
+    cv::Mat light = dcp::EstimateAtmospericLight(image, dark_channel, share);
+    CHECK_EQ(cv::norm(dcp::EstimateAtmospericLight(image, dark_channel,
+                                                   histogram, share),
+                      light, cv::NORM_INF),
+             0);
+    std::vector<size_t> planar_histogram;
+    cv::Mat planar_dark_channel =
+        dcp::DarkChannel(planar_image, 5, planar_histogram);
+    CHECK(planar_histogram == histogram);
+    CHECK_EQ(cv::norm(dcp::EstimateAtmospericLight(
+                          planar_image, planar_dark_channel,
+                          planar_histogram, share),
+                      light, cv::NORM_INF),
+             0);
+  }
+  CHECK_THROWS_WITH_AS(
+      dcp::EstimateAtmospericLight(image, dcp::DarkChannel(image, 5),
+                                   std::vector<size_t>(10), 0.1),
+      "EstimateAtmospericLight(...): histogram has incorrect size",
+      const std::invalid_argument&);
+  CHECK_EQ(dcp::ParseAtmosphericLightMethod("histogram"),
+           dcp::DARK_CHANNEL_HISTOGRAM);
+  CHECK_THROWS_AS(dcp::ParseAtmosphericLightMethod("brightest"),
+                  const std::invalid_argument&);
+}
+
+TEST_CASE("quad-tree atmospheric light") {
+  cv::Mat image(64, 64, CV_64FC3);
+  cv::randu(image, cv::Scalar::all(0), cv::Scalar::all(0.5));
+  // flat haze in the bottom right quadrant, a white object in the top left
+  image(cv::Rect(32, 32, 32, 32)).setTo(cv::Scalar(0.8, 0.85, 0.9));
+  image(cv::Rect(4, 4, 20, 20)).setTo(cv::Scalar(1, 1, 1));
+  cv::Mat ideal(1, 1, CV_64FC3, cv::Scalar(0.8, 0.85, 0.9));
+  CHECK_EQ(cv::norm(dcp::EstimateAtmospericLightQuadTree(image, 8), ideal,
+                    cv::NORM_INF),
+           0);
+  CHECK_EQ(cv::norm(dcp::EstimateAtmospericLightQuadTree(
+                        planar::Image(image), 8),
+                    ideal, cv::NORM_INF),
+           0);
+  CHECK_EQ(cv::norm(dcp::EstimateAtmospericLight(image, 5, 1e-3,
+                                                 dcp::QUAD_TREE),
+                    dcp::EstimateAtmospericLightQuadTree(image),
+                    cv::NORM_INF),
+           0);
+  // the brightest dark channel is on the white object
+  CHECK_EQ(cv::norm(dcp::EstimateAtmospericLight(image, 5),
+                    cv::Mat(1, 1, CV_64FC3, cv::Scalar(1, 1, 1)),
+                    cv::NORM_INF),
+           0);
+
+  cv::Mat packed;
+  image.convertTo(packed, CV_8UC3, 255.0);
+  cv::Mat unpacked;
+  packed.convertTo(unpacked, CV_64FC3, 1.0 / 255.0);
+  CHECK_LT(cv::norm(dcp::EstimateAtmospericLightQuadTree(packed, 8),
+                    dcp::EstimateAtmospericLightQuadTree(unpacked, 8),
+                    cv::NORM_INF),
+           1e-12);
+  // a region of a single pixel is the whole search
+  cv::Mat pixel(1, 1, CV_64FC3, cv::Scalar(0.2, 0.3, 0.4));
+  CHECK_EQ(cv::norm(dcp::EstimateAtmospericLightQuadTree(pixel, 1), pixel,
+                    cv::NORM_INF),
+           0);
+  CHECK_THROWS_WITH_AS(dcp::EstimateAtmospericLightQuadTree(image, 0),
+                       "EstimateAtmospericLightQuadTree(...): region_size "
+                       "must be positive",
+                       const std::invalid_argument&);
+}
+
+TEST_CASE("planar input") {
+  cv::Mat image(19, 26, CV_64FC3);
+  cv::randu(image, cv::Scalar::all(0.05), cv::Scalar::all(1));
+  planar::Image planar_image(image);
+  CHECK(cv::norm(dcp::ChannelMin(planar_image), dcp::ChannelMin(image),
+                 cv::NORM_INF) == 0);
+  cv::Mat dark_channel = dcp::DarkChannel(image, 5);
+  CHECK(cv::norm(dcp::DarkChannel(planar_image, 5), dark_channel,
+                 cv::NORM_INF) == 0);
+  cv::Mat light = dcp::EstimateAtmospericLight(image, dark_channel, 0.05);
+  CHECK(cv::norm(dcp::EstimateAtmospericLight(planar_image, dark_channel,
+                                              0.05),
+                 light, cv::NORM_INF) == 0);
+  cv::Mat transmission = dcp::EstimateTransmission(image, light, 5);
+  CHECK(cv::norm(dcp::EstimateTransmission(planar_image, light, 5),
+                 transmission, cv::NORM_INF) == 0);
+  cv::Mat small(5, 7, CV_64FC3);
+  cv::randu(small, cv::Scalar::all(0), cv::Scalar::all(1));
+  cv::Mat small_transmission(5, 7, CV_64FC1, cv::Scalar(0.4));
+  CHECK(cv::norm(dcp::GuidedUpsample(small_transmission, planar::Image(small),
+                                     planar_image, 1),
+                 dcp::GuidedUpsample(small_transmission, small, image, 1),
+                 cv::NORM_INF) == 0);
+  CHECK_THROWS_WITH_AS(dcp::ChannelMin(planar::Image(cv::Size(3, 3), 1)),
+                       "ChannelMin(...): image has incorrect type",
+                       const std::invalid_argument&);
 }
@@ -0,0 +1,144 @@
+#include <algorithm>
+#include <diode.hpp>
+#include <executor/executor.hpp>
+#include <functional>
+#include <image_loader/image_loader.hpp>
+#include <npy/npy.hpp>
+#include <opencv2/core.hpp>
+#include <opencv2/imgcodecs.hpp>
+#include <parallel/parallel.hpp>
+#include <stdexcept>
+
+namespace fs = std::filesystem;
+
+namespace diode {
+
+const double min_depth = 0.5;
+const double max_depth = 300;
+
+double Percentile(const cv::Mat& values, const double p) {
+  if (values.empty())
+    throw std::invalid_argument("Percentile(...): values are empty");
+  if (p < 0 || p > 100)
+    throw std::invalid_argument("Percentile(...): p is out of range");
+  std::vector<double> data;
+  cv::Mat(values.reshape(1, 1)).convertTo(data, CV_64F);
+  double rank = p / 100.0 * (data.size() - 1);
+  size_t lower = static_cast<size_t>(rank);
+  std::nth_element(data.begin(), data.begin() + lower, data.end());
+  double lower_value = data[lower];
+  if (lower + 1 == data.size()) return lower_value;
+  // the next order statistic is the minimum of the upper part
+  double upper_value = *std::min_element(data.begin() + lower + 1, data.end());
+  return lower_value + (upper_value - lower_value) * (rank - lower);
+}
+
+cv::Mat NormalizeDepth(const cv::Mat& depth, const cv::Mat& mask) {
+  if (depth.channels() != 1 || mask.channels() != 1)
+    throw std::invalid_argument(
+        "NormalizeDepth(...): depth and mask must be single-channel");
+  if (depth.size() != mask.size())
+    throw std::invalid_argument(
+        "NormalizeDepth(...): depth and mask have different sizes");
+  double far = std::min(max_depth, Percentile(depth, 99));
+  cv::Mat result;
+  depth.convertTo(result, CV_64F);
+  cv::min(cv::max(result, min_depth), far, result);
+  cv::Mat invalid;
+  cv::compare(mask, 0, invalid, cv::CMP_LE);
+  result.setTo(far, invalid);
+  double max = 0;
+  cv::minMaxLoc(result, nullptr, &max);
+  return result / max;
+}
+
+cv::Mat QuantizeDepth(const cv::Mat& depth) {
+  if (depth.type() != CV_64FC1)
+    throw std::invalid_argument("QuantizeDepth(...): depth has incorrect type");
+  cv::Mat result(depth.size(), CV_8UC1);
+  for (int i = 0; i < depth.rows; ++i) {
+    const double* src = depth.ptr<double>(i);
+    unsigned char* dst = result.ptr<unsigned char>(i);
+    for (int j = 0; j < depth.cols; ++j)
+      dst[j] = static_cast<unsigned char>(src[j] * 255.);
+  }
+  return result;
+}
+
+cv::Mat LoadDepth(const Sample& sample) {
+  npy::Array depth(sample.depth.u8string());
+  npy::Array mask(sample.mask.u8string());
+  return NormalizeDepth(depth.Image(), mask.Image());
+}
+
+std::vector<Sample> FindSamples(const fs::path& dir,
+                                const size_t num_of_samples) {
+  if (!fs::exists(dir))
+    throw std::runtime_error("FindSamples(...): path doesn't exist");
+  if (!fs::is_directory(dir))
+    throw std::runtime_error("FindSamples(...): path isn't a dir");
+  std::vector<fs::path> images;
+  for (const auto& entry : fs::recursive_directory_iterator{dir})
+    if (!entry.is_directory() && entry.path().extension() == ".png")
+      images.push_back(entry.path());
+  std::sort(images.begin(), images.end());
+  std::vector<Sample> result;
+  for (const auto& image : images) {
+    if (result.size() == num_of_samples) break;
+    std::string stem = image.stem().u8string();
+    Sample sample{image, image.parent_path() / (stem + "_depth.npy"),
+                  image.parent_path() / (stem + "_depth_mask.npy")};
+    if (fs::exists(sample.depth) && fs::exists(sample.mask))
+      result.push_back(sample);
+  }
+  return result;
+}
+
+static void ForEachSample(const std::vector<Sample>& samples, const int jobs,
+                          const std::function<void(const Sample&)>& process) {
+  parallel::ForEach(static_cast<int>(samples.size()), jobs, [&](const int i) {
+    try {
+      process(samples[i]);
+    } catch (const std::exception& ex) {
+      throw std::runtime_error(samples[i].image.filename().u8string() + ": " +
+                               ex.what());
+    }
+  });
+}
+
+static void CheckOutputDir(const fs::path& output_dir) {
+  load::PathWrapper output(output_dir.u8string());
+  if (!output.Empty())
+    throw std::runtime_error("output dir isn't empty");
+}
+
+void Export(const std::vector<Sample>& samples, const fs::path& output_dir,
+            const int jobs) {
+  CheckOutputDir(output_dir);
+  fs::create_directory(output_dir / "images");
+  fs::create_directory(output_dir / "maps");
+  ForEachSample(samples, jobs, [&](const Sample& sample) {
+    cv::Mat map = QuantizeDepth(LoadDepth(sample));
+    fs::path name = sample.image.filename();
+    if (!cv::imwrite((output_dir / "maps" / name).u8string(), map))
+      throw std::runtime_error("cannot write depth map");
+    fs::copy_file(sample.image, output_dir / "images" / name);
+  });
+}
+
+void Augment(const std::vector<Sample>& samples, const fs::path& output_dir,
+             const int jobs) {
+  CheckOutputDir(output_dir);
+  ForEachSample(samples, jobs, [&](const Sample& sample) {
+    std::vector<cv::Mat> images;
+    images.push_back(load::LoadImg(load::PathWrapper(sample.image.u8string())));
+    images.push_back(LoadDepth(sample));
+    exec::Executor ex(images, exec::AUGMENTING);
+    cv::Mat result;
+    ex.Process().back().convertTo(result, CV_8UC3, 255.);
+    if (!cv::imwrite((output_dir / sample.image.filename()).u8string(), result))
+      throw std::runtime_error("cannot write hazy image");
+  });
+}
+
+}  // namespace diode
@@ -0,0 +1,51 @@
+#pragma once
+#ifndef DIODE_HPP
+#define DIODE_HPP
+
+#include <filesystem>
+#include <opencv2/core/mat.hpp>
+#include <string>
+#include <vector>
+
+namespace diode {
+
+struct Sample {
+  std::filesystem::path image;
+  std::filesystem::path depth;
+  std::filesystem::path mask;
+};
+
+// p-th percentile (0..100) with linear interpolation between the closest
+// ranks, as numpy.percentile does, found by selection in linear time.
+double Percentile(const cv::Mat& values, const double p);
+
+// Depth in (0, 1] from DIODE depth in meters: clipped to [0.5, min(300, 99th
+// percentile)], invalid pixels are set to the far limit, then divided by the
+// maximum. The same as diode_sampler.py before 8-bit quantization.
+cv::Mat NormalizeDepth(const cv::Mat& depth, const cv::Mat& mask);
+
+// 8-bit map of a normalized depth: multiplied by 255 and truncated, as
+// np.uint8 does in diode_sampler.py.
+cv::Mat QuantizeDepth(const cv::Mat& depth);
+
+// Memory-maps <image>_depth.npy and <image>_depth_mask.npy of the sample and
+// returns its normalized CV_64FC1 depth map.
+cv::Mat LoadDepth(const Sample& sample);
+
+// The first num_of_samples .png images of the tree (sorted by path) that have
+// depth and mask next to them.
+std::vector<Sample> FindSamples(const std::filesystem::path& dir,
+                                const size_t num_of_samples);
+
+// Writes images/ and maps/ dirs as diode_sampler.py does, with maps as 8-bit
+// PNG; samples are processed in parallel.
+void Export(const std::vector<Sample>& samples,
+            const std::filesystem::path& output_dir, const int jobs = 1);
+
+// Augments the samples with haze using their depth directly, without an 8-bit
+// intermediate, and writes hazy images named after the sources.
+void Augment(const std::vector<Sample>& samples,
+             const std::filesystem::path& output_dir, const int jobs = 1);
+
+}  // namespace diode
+#endif  // DIODE_HPP
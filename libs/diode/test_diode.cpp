@@ -0,0 +1,74 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <doctest.h>
+
+#include <fstream>
+#include <opencv2/core.hpp>
+#include <stdexcept>
+
+#include "diode.hpp"
+
+namespace fs = std::filesystem;
+
+TEST_CASE("Percentile") {
+  float data[10] = {10, 2, 8, 4, 6, 5, 7, 3, 9, 1};
+  cv::Mat values(2, 5, CV_32FC1, data);
+  // numpy.percentile(range(1, 11), 99) == 9.91
+  CHECK(diode::Percentile(values, 99) == doctest::Approx(9.91));
+  CHECK(diode::Percentile(values, 50) == doctest::Approx(5.5));
+  CHECK(diode::Percentile(values, 0) == doctest::Approx(1));
+  CHECK(diode::Percentile(values, 100) == doctest::Approx(10));
+  REQUIRE_THROWS_WITH_AS(diode::Percentile(values, 101),
+                         "Percentile(...): p is out of range",
+                         const std::invalid_argument&);
+}
+
+TEST_CASE("NormalizeDepth") {
+  cv::Mat depth(10, 10, CV_32FC1);
+  for (int i = 0; i < depth.rows; ++i)
+    for (int j = 0; j < depth.cols; ++j)
+      depth.at<float>(i, j) = static_cast<float>(i * depth.cols + j) * 0.1f;
+  depth.at<float>(9, 9) = 1000.f;
+  cv::Mat mask(depth.size(), CV_32FC1, cv::Scalar(1));
+  mask.at<float>(0, 5) = 0;
+  cv::Mat result = diode::NormalizeDepth(depth, mask);
+  REQUIRE_EQ(result.type(), CV_64FC1);
+  double far = diode::Percentile(depth, 99);
+  CHECK(result.at<double>(0, 0) == doctest::Approx(0.5 / far));
+  CHECK(result.at<double>(0, 5) == doctest::Approx(1.0));
+  CHECK(result.at<double>(9, 9) == doctest::Approx(1.0));
+  CHECK(result.at<double>(5, 0) == doctest::Approx(5.0 / far));
+}
+
+TEST_CASE("QuantizeDepth") {
+  cv::Mat depth(1, 4, CV_64FC1);
+  depth.at<double>(0, 0) = 0.0;
+  depth.at<double>(0, 1) = 0.5;
+  depth.at<double>(0, 2) = 254.9 / 255.;
+  depth.at<double>(0, 3) = 1.0;
+  cv::Mat map = diode::QuantizeDepth(depth);
+  REQUIRE_EQ(map.type(), CV_8UC1);
+  // np.uint8(depth * 255) truncates
+  CHECK_EQ(map.at<unsigned char>(0, 0), 0);
+  CHECK_EQ(map.at<unsigned char>(0, 1), 127);
+  CHECK_EQ(map.at<unsigned char>(0, 2), 254);
+  CHECK_EQ(map.at<unsigned char>(0, 3), 255);
+  REQUIRE_THROWS_WITH_AS(diode::QuantizeDepth(cv::Mat(1, 4, CV_32FC1)),
+                         "QuantizeDepth(...): depth has incorrect type",
+                         const std::invalid_argument&);
+}
+
+TEST_CASE("FindSamples") {
+  fs::path root = fs::temp_directory_path() / "test_diode_samples";
+  fs::remove_all(root);
+  fs::create_directories(root / "scene");
+  for (const char* name :
+       {"a.png", "a_depth.npy", "a_depth_mask.npy", "b.png", "b_depth.npy",
+        "c.png", "c_depth.npy", "c_depth_mask.npy"})
+    std::ofstream(root / "scene" / name) << "x";
+  auto samples = diode::FindSamples(root, 10);
+  REQUIRE_EQ(samples.size(), 2);
+  CHECK_EQ(samples[0].image.filename(), "a.png");
+  CHECK_EQ(samples[1].mask.filename(), "c_depth_mask.npy");
+  CHECK_EQ(diode::FindSamples(root, 1).size(), 1);
+  fs::remove_all(root);
+}
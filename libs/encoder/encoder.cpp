@@ -0,0 +1,229 @@
+#include <encoder.hpp>
+#include <fstream>
+#include <npy/npy.hpp>
+#include <opencv2/core.hpp>
+#include <opencv2/imgcodecs.hpp>
+#include <stats/stats.hpp>
+#include <stdexcept>
+#include <trace/trace.hpp>
+
+namespace fs = std::filesystem;
+
+namespace encode {
+
+Format ParseFormat(const std::string& name) {
+  if (name == "source") return SOURCE;
+  if (name == "png") return PNG;
+  if (name == "jpeg" || name == "jpg") return JPEG;
+  if (name == "ppm") return PPM;
+  if (name == "webp") return WEBP;
+  if (name == "raw") return RAW;
+  if (name == "container") return CONTAINER;
+  throw std::invalid_argument("ParseFormat(...): unknown format " + name);
+}
+
+PlaneFormat ParsePlaneFormat(const std::string& name) {
+  if (name == "image") return PLANE_IMAGE;
+  if (name == "f16") return PLANE_FLOAT16;
+  if (name == "f32") return PLANE_FLOAT32;
+  throw std::invalid_argument("ParsePlaneFormat(...): unknown format " +
+                              name);
+}
+
+static std::string Extension(const Format format, const fs::path& path,
+                             const int channels) {
+  switch (format) {
+    case PNG:
+      return ".png";
+    case JPEG:
+      return ".jpg";
+    case PPM:
+      return channels == 1 ? ".pgm" : ".ppm";
+    case WEBP:
+      return ".webp";
+    default:
+      return path.extension().u8string();
+  }
+}
+
+std::vector<unsigned char> EncodeImage(const cv::Mat& image,
+                                       const std::string& extension,
+                                       const EncoderOptions& options) {
+  if (image.channels() != 1 && image.channels() != 3)
+    throw std::invalid_argument(
+        "EncodeImage(...): image must have 1 or 3 channels");
+  cv::Mat ui_image = image;
+  if (image.depth() != CV_8U)
+    image.convertTo(ui_image, CV_MAKETYPE(CV_8U, image.channels()), 255.);
+  std::vector<int> parameters;
+  if (extension == ".png")
+    parameters = {cv::IMWRITE_PNG_COMPRESSION, options.png_compression};
+  else if (extension == ".jpg" || extension == ".jpeg")
+    parameters = {cv::IMWRITE_JPEG_QUALITY, options.jpeg_quality};
+  else if (extension == ".webp")
+    parameters = {cv::IMWRITE_WEBP_QUALITY, options.webp_quality};
+  else if (extension == ".ppm" || extension == ".pgm")
+    parameters = {cv::IMWRITE_PXM_BINARY, 1};
+  std::vector<unsigned char> buffer;
+  if (!cv::imencode(extension, ui_image, buffer, parameters))
+    throw std::runtime_error("EncodeImage(...): cannot encode " + extension);
+  return buffer;
+}
+
+Encoder::Encoder(const EncoderOptions& options, const fs::path& container_path)
+    : options(options) {
+  if (options.format == RAW)
+    throw std::invalid_argument(
+        "Encoder::Encoder(...): raw is only a container codec");
+  if (options.container_codec == SOURCE ||
+      options.container_codec == CONTAINER)
+    throw std::invalid_argument(
+        "Encoder::Encoder(...): container codec is incorrect");
+  if (options.png_compression < 0 || options.png_compression > 9)
+    throw std::invalid_argument(
+        "Encoder::Encoder(...): png compression is out of range");
+  if (options.jpeg_quality < 0 || options.jpeg_quality > 100)
+    throw std::invalid_argument(
+        "Encoder::Encoder(...): jpeg quality is out of range");
+  if (options.webp_quality < 1)
+    throw std::invalid_argument(
+        "Encoder::Encoder(...): webp quality is out of range");
+  if (options.threads < 0)
+    throw std::invalid_argument(
+        "Encoder::Encoder(...): number of threads can't be negative");
+  if (options.format == CONTAINER) {
+    if (container_path.empty())
+      throw std::invalid_argument(
+          "Encoder::Encoder(...): container path is empty");
+    container.reset(new pack::Writer(container_path.u8string()));
+  }
+  for (int i = 0; i < options.threads; ++i)
+    threads.emplace_back([this, i]() {
+      trace::SetThreadName("encoder " + std::to_string(i));
+      Work();
+    });
+}
+
+Encoder::~Encoder() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  not_empty.notify_all();
+  not_full.notify_all();
+  for (auto& thread : threads) thread.join();
+}
+
+void Encoder::WritePlane(const Task& task) {
+  cv::Mat plane;
+  task.image.convertTo(plane, CV_32F);
+  // half floats are converted from single precision
+  if (options.plane_format == PLANE_FLOAT16) plane.convertTo(plane, CV_16F);
+  // raw records are named as the files, they aren't images
+  fs::path path = task.path;
+  path.replace_extension(".npy");
+  if (container) {
+    container->Append(path.filename().u8string(), plane);
+    return;
+  }
+  npy::Write(path.u8string(), plane);
+}
+
+void Encoder::Write(const Task& task) {
+  trace::SetDetail(task.path.filename().u8string());
+  stats::ScopedTimer timer("encode");
+  if (task.plane && options.plane_format != PLANE_IMAGE) {
+    WritePlane(task);
+    return;
+  }
+  if (container) {
+    std::string name = task.path.filename().u8string();
+    cv::Mat ui_image = task.image;
+    if (task.image.depth() != CV_8U)
+      task.image.convertTo(ui_image, CV_MAKETYPE(CV_8U, task.image.channels()),
+                           255.);
+    if (options.container_codec == RAW) {
+      container->Append(name, ui_image);
+      return;
+    }
+    pack::Entry entry;
+    entry.codec = Extension(options.container_codec, task.path,
+                            task.image.channels());
+    entry.rows = ui_image.rows;
+    entry.cols = ui_image.cols;
+    entry.type = ui_image.type();
+    auto buffer = EncodeImage(ui_image, entry.codec, options);
+    container->Append(name, entry, buffer.data(), buffer.size());
+    return;
+  }
+  fs::path path = task.path;
+  path.replace_extension(
+      Extension(options.format, task.path, task.image.channels()));
+  auto buffer = EncodeImage(task.image, path.extension().u8string(), options);
+  std::ofstream file(path, std::ios::binary);
+  file.write(reinterpret_cast<const char*>(buffer.data()), buffer.size());
+  if (!file)
+    throw std::runtime_error("Encoder::Write(...): cannot write " +
+                             path.filename().u8string());
+}
+
+void Encoder::Work() {
+  while (true) {
+    Task task;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      not_empty.wait(lock, [this]() { return stopping || !tasks.empty(); });
+      if (tasks.empty()) return;
+      task = std::move(tasks.front());
+      tasks.pop_front();
+    }
+    not_full.notify_one();
+    try {
+      Write(task);
+    } catch (const std::exception& ex) {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (error.empty()) error = ex.what();
+    }
+  }
+}
+
+void Encoder::Submit(const fs::path& path, const cv::Mat& image) {
+  Enqueue({path, image, false});
+}
+
+void Encoder::SubmitPlane(const fs::path& path, const cv::Mat& plane) {
+  if (plane.channels() != 1)
+    throw std::invalid_argument(
+        "Encoder::SubmitPlane(...): plane must be single-channel");
+  Enqueue({path, plane, true});
+}
+
+void Encoder::Enqueue(Task task) {
+  if (threads.empty()) {
+    Write(task);
+    return;
+  }
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    not_full.wait(lock, [this]() {
+      return tasks.size() < 2 * threads.size() || !error.empty();
+    });
+    if (!error.empty()) throw std::runtime_error(error);
+    tasks.push_back(std::move(task));
+  }
+  not_empty.notify_one();
+}
+
+void Encoder::Finish() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  not_empty.notify_all();
+  for (auto& thread : threads) thread.join();
+  threads.clear();
+  if (!error.empty()) throw std::runtime_error(error);
+  if (container) container->Close();
+}
+
+}  // namespace encode
@@ -0,0 +1,95 @@
+#pragma once
+#ifndef ENCODER_HPP
+#define ENCODER_HPP
+
+#include <condition_variable>
+#include <container/container.hpp>
+#include <deque>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <opencv2/core/mat.hpp>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace encode {
+
+// SOURCE keeps the extension of the input image; CONTAINER packs all images
+// into one file and RAW is only a codec of its records
+enum Format { SOURCE, PNG, JPEG, PPM, WEBP, RAW, CONTAINER };
+
+// single-channel maps (dark channel, transmission) are written as images or as
+// float planes without the 8-bit round trip
+enum PlaneFormat { PLANE_IMAGE, PLANE_FLOAT16, PLANE_FLOAT32 };
+
+struct EncoderOptions {
+  Format format = SOURCE;
+  // 0 (no compression, fastest) .. 9 (smallest)
+  int png_compression = 1;
+  int jpeg_quality = 95;
+  // above 100 WebP is lossless
+  int webp_quality = 100;
+  // 0 encodes in the submitting thread
+  int threads = 0;
+  // records of the container keep raw pixels or are encoded with this format
+  Format container_codec = RAW;
+  PlaneFormat plane_format = PLANE_IMAGE;
+};
+
+Format ParseFormat(const std::string& name);
+
+PlaneFormat ParsePlaneFormat(const std::string& name);
+
+// Encodes a CV_64F image in [0, 1] or a CV_8U one with 1 or 3 channels into
+// the format of the extension (e.g. ".png").
+std::vector<unsigned char> EncodeImage(const cv::Mat& image,
+                                       const std::string& extension,
+                                       const EncoderOptions& options);
+
+// Converts, encodes and writes images, on a pool of threads if requested. The
+// queue is bounded, so submitting blocks while all encoders are busy.
+class Encoder {
+ public:
+  Encoder() = delete;
+  Encoder(const Encoder&) = delete;
+  Encoder(Encoder&&) = delete;
+  Encoder& operator=(const Encoder&) = delete;
+  Encoder& operator=(Encoder&&) = delete;
+  // container_path is the output file for the CONTAINER format
+  explicit Encoder(const EncoderOptions& options,
+                   const std::filesystem::path& container_path = {});
+  ~Encoder();
+  // The extension of path is replaced according to the format; container
+  // records are keyed by the file name of path.
+  void Submit(const std::filesystem::path& path, const cv::Mat& image);
+  // A single-channel CV_64F map in [0, 1], written according to the plane
+  // format: as an image, as a .npy array or as a raw container record.
+  void SubmitPlane(const std::filesystem::path& path, const cv::Mat& plane);
+  // Waits for the queue to drain and rethrows the first encoding error.
+  void Finish();
+
+ private:
+  struct Task {
+    std::filesystem::path path;
+    cv::Mat image;
+    bool plane = false;
+  };
+  void Enqueue(Task task);
+  void Write(const Task& task);
+  void WritePlane(const Task& task);
+  void Work();
+
+  const EncoderOptions options;
+  std::mutex mutex;
+  std::condition_variable not_empty;
+  std::condition_variable not_full;
+  std::deque<Task> tasks;
+  bool stopping = false;
+  std::string error;
+  std::vector<std::thread> threads;
+  std::unique_ptr<pack::Writer> container;
+};
+
+}  // namespace encode
+#endif  // ENCODER_HPP
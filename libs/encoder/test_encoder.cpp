@@ -0,0 +1,126 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <doctest.h>
+
+#include <npy/npy.hpp>
+#include <opencv2/core.hpp>
+#include <opencv2/imgcodecs.hpp>
+#include <stdexcept>
+
+#include "encoder.hpp"
+
+namespace fs = std::filesystem;
+
+TEST_CASE("EncodeImage") {
+  cv::Mat image(8, 8, CV_64FC3, cv::Scalar(0.2, 0.4, 0.6));
+  encode::EncoderOptions options;
+  for (const char* extension : {".png", ".ppm", ".bmp"}) {
+    auto buffer = encode::EncodeImage(image, extension, options);
+    cv::Mat decoded = cv::imdecode(buffer, cv::IMREAD_COLOR);
+    REQUIRE_EQ(decoded.type(), CV_8UC3);
+    cv::Vec3b pixel = decoded.at<cv::Vec3b>(3, 3);
+    CHECK_EQ(pixel[0], 51);
+    CHECK_EQ(pixel[1], 102);
+    CHECK_EQ(pixel[2], 153);
+  }
+  options.png_compression = 0;
+  auto fast = encode::EncodeImage(image, ".png", options);
+  options.png_compression = 9;
+  CHECK(encode::EncodeImage(image, ".png", options).size() <= fast.size());
+  REQUIRE_THROWS_AS(encode::EncodeImage(cv::Mat(2, 2, CV_64FC2), ".png",
+                                        options),
+                    const std::invalid_argument&);
+  CHECK_EQ(encode::ParseFormat("jpeg"), encode::JPEG);
+  REQUIRE_THROWS_AS(encode::ParseFormat("gif"), const std::invalid_argument&);
+}
+
+TEST_CASE("Encoder") {
+  fs::path dir = fs::temp_directory_path() / "test_encoder";
+  fs::remove_all(dir);
+  fs::create_directories(dir);
+  cv::Mat image(8, 8, CV_64FC3, cv::Scalar(0.2, 0.4, 0.6));
+  cv::Mat gray(8, 8, CV_64FC1, cv::Scalar(0.5));
+  encode::EncoderOptions options;
+  options.format = encode::PPM;
+  options.threads = 2;
+  {
+    encode::Encoder encoder(options);
+    for (int i = 0; i < 10; ++i)
+      encoder.Submit(dir / (std::to_string(i) + ".jpg"), image);
+    encoder.Submit(dir / "gray.png", gray);
+    encoder.Finish();
+  }
+  for (int i = 0; i < 10; ++i)
+    CHECK(fs::exists(dir / (std::to_string(i) + ".ppm")));
+  CHECK(fs::exists(dir / "gray.pgm"));
+
+  options.format = encode::SOURCE;
+  options.threads = 0;
+  encode::Encoder encoder(options);
+  encoder.Submit(dir / "same.png", image);
+  encoder.Finish();
+  CHECK(fs::exists(dir / "same.png"));
+
+  options.jpeg_quality = 101;
+  REQUIRE_THROWS_WITH_AS(encode::Encoder{options},
+                         "Encoder::Encoder(...): jpeg quality is out of range",
+                         const std::invalid_argument&);
+  fs::remove_all(dir);
+}
+
+TEST_CASE("Encoder container") {
+  fs::path dir = fs::temp_directory_path() / "test_encoder_container";
+  fs::remove_all(dir);
+  fs::create_directories(dir);
+  cv::Mat image(8, 8, CV_64FC3, cv::Scalar(0.2, 0.4, 0.6));
+  encode::EncoderOptions options;
+  options.format = encode::CONTAINER;
+  options.threads = 2;
+  {
+    encode::Encoder encoder(options, dir / "results.pack");
+    for (int i = 0; i < 10; ++i)
+      encoder.Submit(dir / (std::to_string(i) + ".png"), image);
+    encoder.Finish();
+  }
+  pack::Reader reader((dir / "results.pack").string());
+  REQUIRE_EQ(reader.Names().size(), 10);
+  cv::Mat record = reader.Image("3.png");
+  REQUIRE_EQ(record.type(), CV_8UC3);
+  CHECK_EQ(record.at<cv::Vec3b>(0, 0)[2], 153);
+  CHECK_FALSE(fs::exists(dir / "3.png"));
+  options.container_codec = encode::CONTAINER;
+  REQUIRE_THROWS_AS(encode::Encoder(options, dir / "other.pack"),
+                    const std::invalid_argument&);
+  fs::remove_all(dir);
+}
+
+TEST_CASE("Encoder planes") {
+  fs::path dir = fs::temp_directory_path() / "test_encoder_planes";
+  fs::remove_all(dir);
+  fs::create_directories(dir);
+  cv::Mat plane(6, 4, CV_64FC1, cv::Scalar(0.123456789));
+  encode::EncoderOptions options;
+  options.plane_format = encode::PLANE_FLOAT32;
+  {
+    encode::Encoder encoder(options);
+    encoder.SubmitPlane(dir / "1_tr.png", plane);
+    encoder.Finish();
+  }
+  npy::Array array((dir / "1_tr.npy").string());
+  REQUIRE_EQ(array.Depth(), CV_32F);
+  CHECK(array.Image().at<float>(5, 3) == doctest::Approx(0.123456789));
+
+  options.format = encode::CONTAINER;
+  options.plane_format = encode::PLANE_FLOAT16;
+  {
+    encode::Encoder encoder(options, dir / "results.pack");
+    encoder.SubmitPlane(dir / "1_tr.png", plane);
+    encoder.Finish();
+  }
+  pack::Reader reader((dir / "results.pack").string());
+  CHECK_EQ(reader.Image("1_tr.npy").type(), CV_16FC1);
+  CHECK_FALSE(reader.Contains("1_tr.png"));
+  REQUIRE_THROWS_AS(encode::Encoder(options, dir / "x.pack")
+                        .SubmitPlane(dir / "x.png", cv::Mat(2, 2, CV_64FC3)),
+                    const std::invalid_argument&);
+  fs::remove_all(dir);
+}
@@ -1,32 +1,49 @@
 #include <algorithm>
 #include <dcp.hpp>
+#include <encoder/encoder.hpp>
 #include <executor.hpp>
 #include <haze_model.hpp>
+#include <horizon/horizon.hpp>
 #include <image_loader/image_loader.hpp>
 #include <iostream>
+#include <memory>
 #include <opencv2/core.hpp>
 #include <opencv2/imgcodecs.hpp>
 #include <opencv2/imgproc.hpp>
+#include <parallel/parallel.hpp>
+#include <planar/planar.hpp>
+#include <stats/stats.hpp>
 #include <stdexcept>
+#include <unordered_map>
+#include <trace/trace.hpp>
 
 namespace exec {
 
-Executor::Executor(const std::vector<cv::Mat>& images, const ProcessType type)
+Executor::Executor(const std::vector<cv::Mat>& images, const ProcessType type,
+                   const DehazeParameters& parameters)
     : beta(1.5, 3.0),
       atmospheric_light_val(0.3, 0.7),
       gen(std::random_device()()),
-      type(type) {
+      type(type),
+      parameters(parameters) {
   if (images.size() <= static_cast<size_t>(type))
     throw std::invalid_argument(
         "Executor::Executor(...): num of images is incorrect");
+  if (parameters.scale < 1)
+    throw std::invalid_argument("Executor::Executor(...): scale is incorrect");
   cv::Size img_size = images.front().size();
   std::for_each(images.begin(), images.end(), [&](const cv::Mat& m) {
-    if (m.type() != CV_64FC3)
+    // a depth map may also be single-channel and the image may be packed
+    bool depth_map = type == AUGMENTING && &m == &images[1];
+    bool packed = !depth_map && m.type() == CV_8UC3;
+    if (m.type() != CV_64FC3 && !(depth_map && m.type() == CV_64FC1) &&
+        !packed)
       throw std::invalid_argument(
           "Executor::Executor(...): image types are incorrect");
     if (m.size() != img_size)
       throw std::invalid_argument(
           "Executor::Executor(...): image sizes are incorrect");
+    if (packed) return;
     try {
       cv::checkRange(m, false, 0, -std::numeric_limits<double>::epsilon(),
                      1.0 + std::numeric_limits<double>::epsilon());
@@ -35,7 +52,14 @@ Executor::Executor(const std::vector<cv::Mat>& images, const ProcessType type)
           "Executor::Executor(...): images are out of range");
     }
   });
-  img = images.front().clone();
+  // the input is copied once: a double image to be dehazed goes straight to
+  // the planar layout instead of a clone
+  if (type == DEHAZING && images.front().depth() != CV_8U)
+    planar_img = planar::Image(images.front());
+  else if (type == AUGMENTING && images.front().depth() == CV_8U)
+    images.front().convertTo(img, CV_64FC3, 1.0 / 255.0);
+  else
+    img = images.front().clone();
   if (type == AUGMENTING) {
     depth_map = images[1].clone();
   }
@@ -55,44 +79,247 @@ cv::Mat Executor::Augment() const {
   double v = atmospheric_light_val(gen);
   cv::Mat atmospheric_light(1, 1, CV_64FC3, cv::Scalar(v, v, v));
 
-  std::vector<cv::Mat> maps_1c;
-  cv::split(depth_map, maps_1c);
-  auto& map1c = maps_1c.front();
-  cv::Mat blured_depth_map;
-  cv::blur(map1c, blured_depth_map, cv::Size(30, 30));
   cv::Mat clipped_blured_depth_map;
-  cv::max(blured_depth_map, min_depth_val, clipped_blured_depth_map);
-  haze::CreateTransmission(transmission, clipped_blured_depth_map, beta(gen));
+  {
+    stats::ScopedTimer timer("depth_blur");
+    cv::Mat map1c = depth_map;
+    if (depth_map.channels() != 1) cv::extractChannel(depth_map, map1c, 0);
+    cv::Mat blured_depth_map;
+    cv::blur(map1c, blured_depth_map, cv::Size(30, 30));
+    cv::max(blured_depth_map, min_depth_val, clipped_blured_depth_map);
+  }
+  {
+    stats::ScopedTimer timer("create_transmission");
+    haze::CreateTransmission(transmission, clipped_blured_depth_map,
+                             beta(gen));
+  }
+  stats::ScopedTimer timer("augmentation");
   haze::HazeModel model(transmission, atmospheric_light);
+  // the interleaved kernel is a single pass, a planar one would need two
+  // conversions around it
   cv::Mat result(img.size(), CV_64FC3);
   model.AugmentImage(result, img);
   return result;
 }
-std::vector<cv::Mat> Executor::Dehaze() const {
+
+// Stages of dehazing differ by the image representation only in these
+// helpers: 8-bit images stay interleaved, double ones are planar.
+static cv::Size SizeOf(const cv::Mat& image) { return image.size(); }
+
+static cv::Size SizeOf(const planar::Image& image) { return image.Size(); }
+
+static cv::Mat Downsample(const cv::Mat& image, const int scale) {
+  cv::Mat result;
+  cv::resize(image, result, cv::Size(), 1.0 / scale, 1.0 / scale,
+             cv::INTER_AREA);
+  return result;
+}
+
+static planar::Image Downsample(const planar::Image& image, const int scale) {
+  // the same rounding of the size as cv::resize with factors
+  cv::Size size(cv::saturate_cast<int>(image.Cols() * (1.0 / scale)),
+                cv::saturate_cast<int>(image.Rows() * (1.0 / scale)));
+  return planar::Resize(image, size, cv::INTER_AREA);
+}
+
+static cv::Mat Upsample(const cv::Mat& transmission, const cv::Mat& low_guide,
+                        const cv::Mat& guide, const int radius) {
+  // the guided filter works on doubles
+  cv::Mat low_guide_d = low_guide;
+  cv::Mat guide_d = guide;
+  if (guide.depth() == CV_8U) {
+    low_guide.convertTo(low_guide_d, CV_64FC3, 1.0 / 255.0);
+    guide.convertTo(guide_d, CV_64FC3, 1.0 / 255.0);
+  }
+  return dcp::GuidedUpsample(transmission, low_guide_d, guide_d, radius);
+}
+
+static cv::Mat Upsample(const cv::Mat& transmission,
+                        const planar::Image& low_guide,
+                        const planar::Image& guide, const int radius) {
+  return dcp::GuidedUpsample(transmission, low_guide, guide, radius);
+}
+
+static cv::Mat Recover(const haze::HazeModel& model, const cv::Mat& image) {
+  cv::Mat result(image.size(), image.type());
+  model.RecoverImage(result, image);
+  return result;
+}
+
+static cv::Mat Recover(const haze::HazeModel& model,
+                       const planar::Image& image) {
+  planar::Image result(image.Size(), image.Channels());
+  model.RecoverImage(result, image);
+  return result.ToMat();
+}
+
+// Returns the dark channel, which the histogram method counts as it goes; the
+// quad-tree search doesn't use it, but it's a result as well.
+template <typename Image>
+static cv::Mat EstimateLight(const Image& img, const int patch_size,
+                             const DehazeParameters& parameters,
+                             cv::Mat& atmospheric_light) {
+  bool histogram_method =
+      parameters.atmospheric_light_method == dcp::DARK_CHANNEL_HISTOGRAM;
+  std::vector<size_t> histogram;
+  cv::Mat dark_channel;
+  {
+    stats::ScopedTimer timer("dark_channel");
+    dark_channel = histogram_method
+                       ? dcp::DarkChannel(img, patch_size, histogram)
+                       : dcp::DarkChannel(img, patch_size);
+  }
+  stats::ScopedTimer timer("atmospheric_light");
+  if (parameters.atmospheric_light_method == dcp::QUAD_TREE) {
+    atmospheric_light = dcp::EstimateAtmospericLightQuadTree(img);
+    return dark_channel;
+  }
+  atmospheric_light =
+      histogram_method
+          ? dcp::EstimateAtmospericLight(img, dark_channel, histogram,
+                                         parameters.brightest_share)
+          : dcp::EstimateAtmospericLight(img, dark_channel,
+                                         parameters.brightest_share);
+  return dark_channel;
+}
+
+template <typename Image>
+static std::vector<cv::Mat> DehazeImage(const Image& img,
+                                        const DehazeParameters& parameters) {
   std::vector<cv::Mat> res;
-  res.push_back(dcp::DarkChannel(img, 15));
-  cv::Mat atmospheric_light = dcp::EstimateAtmospericLight(img, 15);
-  cv::Mat transmission = dcp::EstimateTransmission(img, atmospheric_light, 15);
-  res.push_back(transmission);
-  cv::Mat matting_tr = dcp::SoftMatting(transmission, img, 51, 0.01);
-  haze::HazeModel model(matting_tr, atmospheric_light);
-  cv::Mat result(img.size(), CV_64FC3);
-  model.RecoverImage(result, img);
-  res.push_back(result);
+  cv::Mat atmospheric_light;
+  cv::Mat matting_tr;
+  cv::Size size = SizeOf(img);
+  if (parameters.scale == 1) {
+    res.push_back(EstimateLight(img, parameters.patch_size, parameters,
+                                atmospheric_light));
+    {
+      stats::ScopedTimer timer("transmission");
+      res.push_back(dcp::EstimateTransmission(
+          img, atmospheric_light, parameters.patch_size, parameters.omega));
+    }
+    stats::ScopedTimer timer("refinement");
+    // the box filter of SoftMatting doesn't look at the image
+    matting_tr = dcp::SoftMatting(res.back(), cv::Mat(),
+                                  parameters.matting_patch_size, 0.01);
+  } else {
+    if (size.height < parameters.scale || size.width < parameters.scale)
+      throw std::invalid_argument(
+          "Executor::Dehaze(...): image is too small for the scale");
+    Image small_img;
+    {
+      stats::ScopedTimer timer("downsampling");
+      small_img = Downsample(img, parameters.scale);
+    }
+    int small_patch_size = (parameters.patch_size / parameters.scale) | 1;
+    int small_radius =
+        std::max(1, parameters.matting_patch_size / 2 / parameters.scale);
+    cv::Mat small_dark_channel = EstimateLight(
+        small_img, small_patch_size, parameters, atmospheric_light);
+    cv::Mat small_transmission;
+    {
+      stats::ScopedTimer timer("transmission");
+      small_transmission = dcp::EstimateTransmission(
+          small_img, atmospheric_light, small_patch_size, parameters.omega);
+    }
+    {
+      stats::ScopedTimer timer("upsampling");
+      cv::Mat dark_channel;
+      cv::Mat transmission;
+      cv::resize(small_dark_channel, dark_channel, size);
+      cv::resize(small_transmission, transmission, size);
+      res.push_back(dark_channel);
+      res.push_back(transmission);
+    }
+    stats::ScopedTimer timer("refinement");
+    matting_tr = Upsample(small_transmission, small_img, img, small_radius);
+  }
+  stats::ScopedTimer timer("recovery");
+  haze::HazeModel model(matting_tr, atmospheric_light, parameters.t0);
+  res.push_back(Recover(model, img));
   return res;
 }
 
+std::vector<cv::Mat> Executor::Dehaze() const {
+  if (planar_img.Empty()) return DehazeImage(img, parameters);
+  return DehazeImage(planar_img, parameters);
+}
+
 static std::string ResultErrorMessage(const std::string& lwhat,
                                       const std::string& rwhat) {
   return lwhat + rwhat + "\n";
 }
 
-void Produce(const std::vector<std::string>& input_pathes,
-             std::string& result_path) {
+static void ProduceImage(const load::PathWrapper& image_path,
+                         const load::PathWrapper* depth_map_path,
+                         const load::PathWrapper* ground_truth_path,
+                         const load::PathWrapper& result,
+                         const ProcessType type, const ProduceOptions& options,
+                         encode::Encoder* encoder, ImageScores* scores) {
+  stats::ScopedTimer image_timer("image");
+  std::string name = image_path.name;
+  std::vector<cv::Mat> images;
+  {
+    stats::ScopedTimer timer("decode");
+    // dehazed images stay 8-bit from decoding to encoding unless they are
+    // scored, which needs the result before quantization
+    if (type == DEHAZING && ground_truth_path == nullptr)
+      images.push_back(load::LoadPackedImg(image_path));
+    else
+      images.push_back(load::LoadImg(image_path));
+    if (type == AUGMENTING && depth_map_path != nullptr) {
+      // depth maps may be stored in another format, e.g. .npy or .exr
+      if (image_path.path.stem() != depth_map_path->path.stem())
+        throw std::runtime_error("Produce(): files must have equal filename");
+      images.push_back(load::LoadDepth(*depth_map_path));
+    }
+  }
+  if (type == AUGMENTING && depth_map_path == nullptr) {
+    stats::ScopedTimer timer("horizon_depth");
+    images.push_back(horizon::HorizonDepth(images.front()));
+  }
+  std::unique_ptr<Executor> ex;
+  {
+    stats::ScopedTimer timer("validation");
+    ex.reset(new Executor(images, type, options.parameters));
+  }
+  auto imgs = ex->Process();
+  cv::Mat result_image = imgs.back();
+  if (ground_truth_path != nullptr) {
+    cv::Mat ground_truth;
+    {
+      stats::ScopedTimer timer("decode");
+      ground_truth = load::LoadImg(*ground_truth_path);
+    }
+    stats::ScopedTimer timer("evaluation");
+    // the written image saturates to [0, 1] as well
+    cv::Mat clipped;
+    cv::min(cv::max(result_image, 0.0), 1.0, clipped);
+    scores->name = name;
+    scores->scores = metrics::CompareAs8Bit(clipped, ground_truth);
+  }
+  if (!options.write_outputs) return;
+  encoder->Submit(result.path / name, result_image);
+  if (type == DEHAZING && options.diagnostics) {
+    std::string stem = name.substr(0, name.find('.'));
+    std::string ext = name.substr(name.find('.'));
+    encoder->SubmitPlane(result.path / (stem + "_dc" + ext), imgs[0]);
+    encoder->SubmitPlane(result.path / (stem + "_tr" + ext), imgs[1]);
+  }
+}
+
+std::vector<ImageScores> Produce(const std::vector<std::string>& input_pathes,
+                                 std::string& result_path,
+                                 const ProduceOptions& options) {
+  if (options.jobs < 1)
+    throw std::invalid_argument("Produce(): number of jobs must be positive");
   std::vector<load::PathWrapper> images_pathes;
   std::vector<load::PathWrapper> depth_map_pathes;
 
-  ProcessType type = DEHAZING;
+  if (options.horizon_depth && input_pathes.size() > 1)
+    throw std::invalid_argument(
+        "Produce(): horizon depth needs a single input dir");
+  ProcessType type = options.horizon_depth ? AUGMENTING : DEHAZING;
 
   try {
     images_pathes = load::LoadDir(input_pathes.front());
@@ -106,56 +333,71 @@ void Produce(const std::vector<std::string>& input_pathes,
   }
 
   size_t size = images_pathes.size();
-  if (depth_map_pathes.size() != size && type == AUGMENTING)
+  if (depth_map_pathes.size() != size && type == AUGMENTING &&
+      !options.horizon_depth)
     throw std::runtime_error(
         "Produce(): input dirs has different numbers of files\n");
 
+  std::vector<load::PathWrapper> ground_truth_pathes;
+  if (!options.ground_truth_path.empty()) {
+    std::unordered_map<std::string, load::PathWrapper> ground_truth;
+    try {
+      for (auto& path : load::LoadDir(options.ground_truth_path))
+        ground_truth.emplace(path.name, path);
+    } catch (const std::exception& ex) {
+      throw std::runtime_error(ResultErrorMessage(
+          "Produce(): cannot load content of ground truth dir:\n", ex.what()));
+    }
+    for (const auto& path : images_pathes) {
+      auto it = ground_truth.find(path.name);
+      if (it == ground_truth.end())
+        throw std::runtime_error("Produce(): no ground truth for " +
+                                 path.name + "\n");
+      ground_truth_pathes.push_back(it->second);
+    }
+  }
+
   load::PathWrapper result(result_path);
-  try {
-    if (!result.Empty())
-      throw std::runtime_error("Produce(): result dir isn't empty");
-  } catch (const std::exception& ex) {
-    throw std::runtime_error(
-        ResultErrorMessage("Produce(): incorrect result dir:\n", ex.what()));
+  if (options.write_outputs) {
+    try {
+      if (!result.Empty())
+        throw std::runtime_error("Produce(): result dir isn't empty");
+    } catch (const std::exception& ex) {
+      throw std::runtime_error(
+          ResultErrorMessage("Produce(): incorrect result dir:\n", ex.what()));
+    }
   }
 
+  std::vector<ImageScores> scores(ground_truth_pathes.size());
+  std::unique_ptr<encode::Encoder> encoder;
+  if (options.write_outputs)
+    encoder.reset(
+        new encode::Encoder(options.encoding, result.path / "results.pack"));
+
+  // workers take images one by one; the first error stops them all
   try {
-    for (size_t i = 0; i < size; ++i) {
-      std::string name = images_pathes[i].name;
-      std::vector<cv::Mat> images{load::LoadImg(images_pathes[i])};
-      if (type == AUGMENTING) {
-        if (images_pathes[i].name != depth_map_pathes[i].name)
-          throw std::runtime_error("Produce(): files must have equal filename");
-        images.push_back(load::LoadImg(depth_map_pathes[i]));
-      }
-      Executor ex(images, type);
-      auto imgs = ex.Process();
-      cv::Mat result_image = imgs.back();
-      load::PathWrapper result_file_path;
-      result_file_path.path = result.path / name;
-      cv::Mat ui_result_image;
-      result_image.convertTo(ui_result_image, CV_8UC3, 255.);
-      cv::imwrite(result_file_path.ToString(), ui_result_image);
-      if (type == DEHAZING) {
-        load::PathWrapper result_dc;
-        load::PathWrapper result_tr;
-        std::string ext = name.substr(name.find('.'));
-        result_dc.path =
-            result.path / (name.substr(0, name.find('.')) + "_dc" + ext);
-        result_tr.path =
-            result.path / (name.substr(0, name.find('.')) + "_tr" + ext);
-        cv::Mat ui_dc_image;
-        cv::Mat ui_tr_image;
-        imgs[0].convertTo(ui_dc_image, CV_8UC3, 255.);
-        imgs[1].convertTo(ui_tr_image, CV_8UC3, 255.);
-        cv::imwrite(result_dc.ToString(), ui_dc_image);
-        cv::imwrite(result_tr.ToString(), ui_tr_image);
-      }
-    }
+    parallel::ForEach(static_cast<int>(size), options.jobs, [&](const int i) {
+      trace::SetThreadName("worker");
+      trace::SetDetail(images_pathes[i].name);
+      ProduceImage(images_pathes[i],
+                   depth_map_pathes.empty() ? nullptr : &depth_map_pathes[i],
+                   scores.empty() ? nullptr : &ground_truth_pathes[i], result,
+                   type, options, encoder.get(),
+                   scores.empty() ? nullptr : &scores[i]);
+    });
   } catch (const std::exception& ex) {
     throw std::runtime_error(ResultErrorMessage(
         "Produce(): cannot augment/dehaze image:\n", ex.what()));
   }
+  if (encoder) {
+    try {
+      encoder->Finish();
+    } catch (const std::exception& ex) {
+      throw std::runtime_error(
+          ResultErrorMessage("Produce(): cannot write image:\n", ex.what()));
+    }
+  }
+  return scores;
 }
 
 }  // namespace exec
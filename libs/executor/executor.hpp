@@ -2,14 +2,32 @@
 #ifndef EXECUTOR_HPP
 #define EXECUTOR_HPP
 
+#include <dcp/dcp.hpp>
+#include <encoder/encoder.hpp>
+#include <metrics/metrics.hpp>
 #include <opencv2/core/mat.hpp>
+#include <planar/planar.hpp>
 #include <random>
+#include <string>
 #include <vector>
 
 namespace exec {
 
 enum ProcessType { DEHAZING, AUGMENTING };
 
+struct DehazeParameters {
+  int patch_size = 15;
+  double omega = 0.95;
+  double brightest_share = 1e-3;
+  dcp::AtmosphericLightMethod atmospheric_light_method = dcp::TOP_DARK_CHANNEL;
+  int matting_patch_size = 51;
+  double t0 = 0.1;
+  // atmospheric light and the coarse transmission are estimated on the image
+  // downsampled by this factor and the transmission is brought back to full
+  // resolution by guided upsampling
+  int scale = 1;
+};
+
 class Executor {
  private:
   Executor() = delete;
@@ -21,7 +39,11 @@ class Executor {
   std::vector<cv::Mat> Dehaze() const;
 
  public:
-  Executor(const std::vector<cv::Mat>& images, const ProcessType type);
+  // images are CV_64FC3 in [0, 1] or CV_8UC3; for augmenting the second one
+  // is the depth map, which may be CV_64FC1 as well. A CV_8UC3 image is
+  // dehazed without unpacking into CV_64FC3 and gives a CV_8UC3 result.
+  Executor(const std::vector<cv::Mat>& images, const ProcessType type,
+           const DehazeParameters& parameters = DehazeParameters());
   std::vector<cv::Mat> Process() const;
   ~Executor() = default;
 
@@ -32,12 +54,39 @@ class Executor {
       atmospheric_light_val;  // (0.3, 0.7);
   mutable std::mt19937 gen;
   cv::Mat img;
+  // a double image to be dehazed, img stays empty then
+  planar::Image planar_img;
   cv::Mat depth_map;
   const ProcessType type;
+  const DehazeParameters parameters;
+};
+
+struct ProduceOptions {
+  DehazeParameters parameters;
+  // number of worker threads, each processes whole images
+  int jobs = 1;
+  // if set, every result is scored in memory against the image of the same
+  // name from this dir, before quantization to 8 bits
+  std::string ground_truth_path;
+  // without outputs the result dir is neither checked nor written
+  bool write_outputs = true;
+  // augments a single dir, generating depth from the sky of horizon photos
+  bool horizon_depth = false;
+  // the CONTAINER format writes everything into results.pack in the result dir
+  encode::EncoderOptions encoding;
+  // also write the dark channel (_dc) and transmission (_tr) of dehazed images
+  bool diagnostics = false;
+};
+
+struct ImageScores {
+  std::string name;
+  metrics::Scores scores;
 };
 
-void Produce(const std::vector<std::string>& input_pathes,
-             std::string& result_path);
+// Returns the scores sorted by image name, empty without ground truth.
+std::vector<ImageScores> Produce(
+    const std::vector<std::string>& input_pathes, std::string& result_path,
+    const ProduceOptions& options = ProduceOptions());
 
 }  // namespace exec
 #endif  // EXECUTOR_HPP
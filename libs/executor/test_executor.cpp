@@ -1,10 +1,15 @@
 #define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
 #include <doctest.h>
 
+#include <cmath>
 #include <executor.hpp>
+#include <filesystem>
 #include <opencv2/core.hpp>
+#include <opencv2/imgcodecs.hpp>
 #include <stdexcept>
 
+namespace fs = std::filesystem;
+
 TEST_CASE("image_processor") {
   std::vector<cv::Mat> mats;
   REQUIRE_THROWS_WITH_AS([&]() { exec::Executor ex(mats, exec::DEHAZING); }(),
@@ -41,3 +46,139 @@ TEST_CASE("image_processor") {
   CHECK(result_augmenting.back().size() == s);
   CHECK_EQ(result_augmenting.back().type(), CV_64FC3);
 }
+
+TEST_CASE("downsampled dehazing") {
+  std::vector<cv::Mat> mats;
+  mats.emplace_back(40, 64, CV_64FC3);
+  cv::randu(mats.back(), cv::Scalar::all(0.1), cv::Scalar::all(0.9));
+  exec::DehazeParameters parameters;
+  parameters.scale = 0;
+  REQUIRE_THROWS_WITH_AS(
+      [&]() { exec::Executor ex(mats, exec::DEHAZING, parameters); }(),
+      "Executor::Executor(...): scale is incorrect",
+      const std::invalid_argument&);
+  parameters.scale = 4;
+  exec::Executor processor(mats, exec::DEHAZING, parameters);
+  std::vector<cv::Mat> result;
+  REQUIRE_NOTHROW(result = processor.Process());
+  REQUIRE_EQ(result.size(), 3);
+  for (const auto& m : result) CHECK(m.size() == mats.front().size());
+  CHECK_EQ(result.back().type(), CV_64FC3);
+  parameters.scale = 128;
+  exec::Executor too_small(mats, exec::DEHAZING, parameters);
+  REQUIRE_THROWS_WITH_AS(
+      too_small.Process(),
+      "Executor::Dehaze(...): image is too small for the scale",
+      const std::invalid_argument&);
+}
+
+TEST_CASE("packed dehazing") {
+  cv::Mat packed(24, 32, CV_8UC3);
+  cv::randu(packed, cv::Scalar::all(30), cv::Scalar::all(230));
+  cv::Mat image;
+  packed.convertTo(image, CV_64FC3, 1.0 / 255.0);
+  exec::DehazeParameters parameters;
+  parameters.patch_size = 5;
+  parameters.matting_patch_size = 7;
+  auto ideal = exec::Executor({image}, exec::DEHAZING, parameters).Process();
+  auto result = exec::Executor({packed}, exec::DEHAZING, parameters).Process();
+  REQUIRE_EQ(result.size(), 3);
+  REQUIRE_EQ(result.back().type(), CV_8UC3);
+  CHECK(cv::norm(result[1], ideal[1], cv::NORM_INF) < 1e-9);
+  cv::Mat ui_ideal;
+  ideal.back().convertTo(ui_ideal, CV_8UC3, 255.);
+  CHECK(cv::norm(result.back(), ui_ideal, cv::NORM_INF) <= 1);
+}
+
+TEST_CASE("histogram atmospheric light") {
+  cv::Mat packed(24, 32, CV_8UC3);
+  cv::randu(packed, cv::Scalar::all(30), cv::Scalar::all(230));
+  cv::Mat image;
+  packed.convertTo(image, CV_64FC3, 1.0 / 255.0);
+  exec::DehazeParameters parameters;
+  parameters.patch_size = 5;
+  parameters.matting_patch_size = 7;
+  exec::DehazeParameters histogram_parameters = parameters;
+  histogram_parameters.atmospheric_light_method = dcp::DARK_CHANNEL_HISTOGRAM;
+  for (const cv::Mat& input : {packed, image}) {
+    auto ideal = exec::Executor({input}, exec::DEHAZING, parameters).Process();
+    auto result =
+        exec::Executor({input}, exec::DEHAZING, histogram_parameters)
+            .Process();
+    CHECK(cv::norm(result.back(), ideal.back(), cv::NORM_INF) == 0);
+  }
+}
+
+TEST_CASE("Produce options") {
+  exec::ProduceOptions options;
+  options.jobs = 0;
+  std::string result_path;
+  REQUIRE_THROWS_WITH_AS(exec::Produce({"."}, result_path, options),
+                         "Produce(): number of jobs must be positive",
+                         const std::invalid_argument&);
+}
+
+TEST_CASE("Produce evaluation") {
+  fs::path root = fs::temp_directory_path() / "test_executor_eval";
+  fs::remove_all(root);
+  fs::create_directories(root / "hazy");
+  fs::create_directories(root / "gt");
+  cv::Mat image(40, 40, CV_8UC3);
+  cv::RNG rng(42);
+  rng.fill(image, cv::RNG::UNIFORM, 0, 256);
+  cv::imwrite((root / "hazy" / "1.png").string(), image);
+  cv::imwrite((root / "gt" / "1.png").string(), image);
+  exec::ProduceOptions options;
+  options.parameters.matting_patch_size = 7;
+  options.ground_truth_path = (root / "gt").string();
+  options.write_outputs = false;
+  std::string result_path;
+  auto scores = exec::Produce({(root / "hazy").string()}, result_path, options);
+  REQUIRE_EQ(scores.size(), 1);
+  CHECK_EQ(scores.front().name, "1.png");
+  // the scores of the clipped result on the 8-bit scale of haze_compare
+  cv::Mat unit;
+  image.convertTo(unit, CV_64FC3, 1 / 255.0);
+  cv::Mat result =
+      exec::Executor({unit}, exec::DEHAZING, options.parameters)
+          .Process()
+          .back();
+  cv::min(cv::max(result, 0.0), 1.0, result);
+  cv::Mat diff = result - unit;
+  double mse = cv::norm(diff, cv::NORM_L2SQR) / (diff.total() * 3) * 65025;
+  CHECK(scores.front().scores.mse == doctest::Approx(mse));
+  CHECK(scores.front().scores.psnr ==
+        doctest::Approx(10 * std::log10(65025 / mse)));
+  CHECK(scores.front().scores.ssim ==
+        doctest::Approx(metrics::SSIM(result, unit, 1.0)));
+
+  fs::remove(root / "gt" / "1.png");
+  cv::imwrite((root / "gt" / "2.png").string(), image);
+  REQUIRE_THROWS_AS(
+      exec::Produce({(root / "hazy").string()}, result_path, options),
+      const std::runtime_error&);
+  fs::remove_all(root);
+}
+
+TEST_CASE("single-channel depth map") {
+  std::vector<cv::Mat> mats;
+  mats.emplace_back(20, 40, CV_64FC3, cv::Scalar(0.5, 0.5, 0.5));
+  mats.emplace_back(20, 40, CV_64FC1, cv::Scalar(0.7));
+  exec::Executor processor(mats, exec::AUGMENTING);
+  std::vector<cv::Mat> result;
+  REQUIRE_NOTHROW(result = processor.Process());
+  CHECK_EQ(result.back().type(), CV_64FC3);
+  REQUIRE_THROWS_WITH_AS(
+      [&]() { exec::Executor ex({mats[1], mats[0]}, exec::AUGMENTING); }(),
+      "Executor::Executor(...): image types are incorrect",
+      const std::invalid_argument&);
+}
+
+TEST_CASE("Produce horizon depth") {
+  exec::ProduceOptions options;
+  options.horizon_depth = true;
+  std::string result_path;
+  REQUIRE_THROWS_WITH_AS(exec::Produce({".", "."}, result_path, options),
+                         "Produce(): horizon depth needs a single input dir",
+                         const std::invalid_argument&);
+}
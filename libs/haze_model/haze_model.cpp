@@ -1,6 +1,10 @@
+#include <algorithm>
+#include <cmath>
 #include <haze_model.hpp>
 #include <opencv2/core.hpp>
+#include <simd/simd.hpp>
 #include <stdexcept>
+#include <vector>
 
 namespace haze {
 
@@ -32,25 +36,20 @@ void HazeModel::AugmentImage(cv::Mat& result,
   if (result.size() != transmission.size())
     throw std::invalid_argument(
         "HazeModel::AugmentImage(...): incorrect size of result");
-  cv::Mat transmission_3_ch;
-  cv::Mat channels[3] = {transmission, transmission, transmission};
-  cv::merge(channels, 3, transmission_3_ch);
-  cv::Mat inverse_transmission = cv::Mat(transmission.size(), CV_64FC3,
-                                         cv::Vec<double, 3>(1.0, 1.0, 1.0)) -
-                                 transmission_3_ch;
-  cv::Mat atmospheric_light_image(
-      transmission.size(), CV_64FC3,
-      atmospheric_light.at<cv::Vec<double, 3>>(0, 0));
-  result = transmission_3_ch.mul(scene_radiance) +
-           inverse_transmission.mul(atmospheric_light_image);
+  // one pass without the three-channel copies of the transmission
+  const double* light = atmospheric_light.ptr<double>(0);
+  for (int i = 0; i < result.rows; ++i)
+    simd::Augment(scene_radiance.ptr<double>(i), transmission.ptr<double>(i),
+                  result.ptr<double>(i), result.cols, light);
 }
 
 void HazeModel::RecoverImage(cv::Mat& result,
                              const cv::Mat& observed_intensity) const {
-  if (observed_intensity.type() != CV_64FC3)
+  if (observed_intensity.type() != CV_64FC3 &&
+      observed_intensity.type() != CV_8UC3)
     throw std::invalid_argument(
         "HazeModel::RecoverImage(...): incorrect type of input");
-  if (result.type() != CV_64FC3)
+  if (result.type() != observed_intensity.type())
     throw std::invalid_argument(
         "HazeModel::RecoverImage(...): incorrect type of result");
   if (observed_intensity.size() != transmission.size())
@@ -59,20 +58,92 @@ void HazeModel::RecoverImage(cv::Mat& result,
   if (result.size() != transmission.size())
     throw std::invalid_argument(
         "HazeModel::RecoverImage(...): incorrect size of result");
-  cv::Mat atmospheric_light_image(
-      transmission.size(), CV_64FC3,
-      atmospheric_light.at<cv::Vec<double, 3>>(0, 0));
-  cv::Mat t0_image(transmission.size(), CV_64FC1, cv::Vec<double, 1>(t0));
-  cv::Mat transmission_low_bounded_t0(transmission.size(), CV_64FC1);
-  cv::max(transmission, t0_image, transmission_low_bounded_t0);
-  cv::Mat transmission_low_bounded_t0_c3;
-  cv::Mat channels[3] = {transmission_low_bounded_t0,
-                         transmission_low_bounded_t0,
-                         transmission_low_bounded_t0};
-  cv::merge(channels, 3, transmission_low_bounded_t0_c3);
-  result = (observed_intensity - atmospheric_light_image)
-               .mul(1. / transmission_low_bounded_t0_c3) +
-           atmospheric_light_image;
+  if (observed_intensity.depth() == CV_8U) {
+    RecoverPacked(result, observed_intensity);
+    return;
+  }
+  const double* light = atmospheric_light.ptr<double>(0);
+  for (int i = 0; i < result.rows; ++i)
+    simd::Recover(observed_intensity.ptr<double>(i),
+                  transmission.ptr<double>(i), result.ptr<double>(i),
+                  result.cols, light, t0);
+}
+
+void HazeModel::RecoverPacked(cv::Mat& result,
+                              const cv::Mat& observed_intensity) const {
+  // unpacking, recovery and saturating packing happen in one pass
+  cv::Vec3d light = atmospheric_light.at<cv::Vec3d>(0, 0);
+  double lut[3][256];
+  for (int c = 0; c < 3; ++c)
+    for (int v = 0; v < 256; ++v) lut[c][v] = v / 255.0 - light[c];
+  for (int i = 0; i < result.rows; ++i) {
+    const unsigned char* src = observed_intensity.ptr<unsigned char>(i);
+    const double* tr = transmission.ptr<double>(i);
+    unsigned char* dst = result.ptr<unsigned char>(i);
+    for (int j = 0; j < result.cols; ++j) {
+      double inverse_tr = 1.0 / std::max(tr[j], t0);
+      for (int c = 0; c < 3; ++c, ++src, ++dst)
+        *dst = cv::saturate_cast<unsigned char>(
+            (lut[c][*src] * inverse_tr + light[c]) * 255.0);
+    }
+  }
+}
+
+void HazeModel::CheckPlanar(const planar::Image& result,
+                            const planar::Image& input,
+                            const std::string& name) const {
+  if (input.Channels() != 3)
+    throw std::invalid_argument("HazeModel::" + name +
+                                "(...): incorrect type of input");
+  if (result.Channels() != 3)
+    throw std::invalid_argument("HazeModel::" + name +
+                                "(...): incorrect type of result");
+  if (input.Size() != transmission.size())
+    throw std::invalid_argument("HazeModel::" + name +
+                                "(...): incorrect size of input");
+  if (result.Size() != transmission.size())
+    throw std::invalid_argument("HazeModel::" + name +
+                                "(...): incorrect size of result");
+}
+
+void HazeModel::AugmentImage(planar::Image& result,
+                             const planar::Image& scene_radiance) const {
+  CheckPlanar(result, scene_radiance, "AugmentImage");
+  const double* light = atmospheric_light.ptr<double>(0);
+  for (int c = 0; c < 3; ++c)
+    for (int i = 0; i < result.Rows(); ++i)
+      simd::AugmentPlane(scene_radiance.Row(c, i),
+                         transmission.ptr<double>(i), result.Row(c, i),
+                         result.Cols(), light[c]);
+}
+
+void HazeModel::RecoverImage(planar::Image& result,
+                             const planar::Image& observed_intensity) const {
+  CheckPlanar(result, observed_intensity, "RecoverImage");
+  const double* light = atmospheric_light.ptr<double>(0);
+  for (int c = 0; c < 3; ++c)
+    for (int i = 0; i < result.Rows(); ++i)
+      simd::RecoverPlane(observed_intensity.Row(c, i),
+                         transmission.ptr<double>(i), result.Row(c, i),
+                         result.Cols(), light[c], t0);
+}
+
+template <typename T>
+static void TransmissionLUT(cv::Mat& transmission, const cv::Mat& depth_map,
+                            const double beta, const double scale) {
+  // the table covers only the values present in the map
+  double min = 0;
+  double max = 0;
+  cv::minMaxLoc(depth_map, &min, &max);
+  std::vector<double> lut(static_cast<size_t>(max - min) + 1);
+  for (size_t v = 0; v < lut.size(); ++v)
+    lut[v] = std::exp(-beta * scale * (v + min));
+  int offset = static_cast<int>(min);
+  for (int i = 0; i < depth_map.rows; ++i) {
+    const T* src = depth_map.ptr<T>(i);
+    double* dst = transmission.ptr<double>(i);
+    for (int j = 0; j < depth_map.cols; ++j) dst[j] = lut[src[j] - offset];
+  }
 }
 
 void CreateTransmission(cv::Mat& transmission, const cv::Mat& depth_map,
@@ -80,10 +151,22 @@ void CreateTransmission(cv::Mat& transmission, const cv::Mat& depth_map,
   if (transmission.size() != depth_map.size())
     throw std::invalid_argument(
         "CreateTransmission(...): incorrect sizes of matrices");
-  if (transmission.type() != depth_map.type())
+  // the table of an integer map holds doubles
+  bool integer = depth_map.type() == CV_8UC1 || depth_map.type() == CV_16UC1;
+  if (integer ? transmission.type() != CV_64FC1
+              : transmission.type() != depth_map.type())
     throw std::invalid_argument(
         "CreateTransmission(...): incorrect types of matrices");
-  cv::exp(-beta * depth_map, transmission);
+  if (depth_map.type() == CV_8UC1) {
+    TransmissionLUT<unsigned char>(transmission, depth_map, beta, 1.0 / 255.0);
+  } else if (depth_map.type() == CV_16UC1) {
+    TransmissionLUT<unsigned short>(transmission, depth_map, beta,
+                                    1.0 / 65535.0);
+  } else {
+    // in place, without a temporary for -beta * depth_map
+    cv::multiply(depth_map, -beta, transmission);
+    cv::exp(transmission, transmission);
+  }
 }
 
 }  // namespace haze
@@ -3,9 +3,14 @@
 #define HAZE_MODEL_HPP
 
 #include <opencv2/core/mat.hpp>
+#include <planar/planar.hpp>
+#include <string>
 
 namespace haze {
 
+// t = exp(-beta * d). A CV_8UC1 or CV_16UC1 depth map is scaled by the
+// maximum of its type and looked up in a table of exp built once per call,
+// the transmission is CV_64FC1 then; other maps go through cv::exp in place.
 void CreateTransmission(cv::Mat &transmission, const cv::Mat &depth_map,
                         const double beta);
 
@@ -23,8 +28,20 @@ class HazeModel {
   HazeModel &operator=(HazeModel &&) = delete;
   HazeModel(const cv::Mat &tr, const cv::Mat &al, const double t0 = 0.1);
   void AugmentImage(cv::Mat &result, const cv::Mat &scene_radiance) const;
+  // CV_8UC3 input is recovered straight into CV_8UC3 result, saturated as
+  // convertTo(CV_8UC3, 255.) would do
   void RecoverImage(cv::Mat &result, const cv::Mat &observed_intensity) const;
+  // the same over planar three-channel images, plane by plane
+  void AugmentImage(planar::Image &result,
+                    const planar::Image &scene_radiance) const;
+  void RecoverImage(planar::Image &result,
+                    const planar::Image &observed_intensity) const;
   ~HazeModel() = default;
+
+ private:
+  void RecoverPacked(cv::Mat &result, const cv::Mat &observed_intensity) const;
+  void CheckPlanar(const planar::Image &result, const planar::Image &input,
+                   const std::string &name) const;
 };
 
 }  // namespace haze
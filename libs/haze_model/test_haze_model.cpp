@@ -343,3 +343,47 @@ TEST_CASE("t0 is not zero") {
   model.RecoverImage(recovered_image, hazy_image);
   CHECK(IsDoubleMatsEqual(recovered_image, ideal_recovered_image));
 }
+
+TEST_CASE("packed recovery") {
+  cv::Mat transmission(9, 11, CV_64FC1);
+  cv::randu(transmission, cv::Scalar(0.05), cv::Scalar(1.0));
+  cv::Mat atmospheric_light(1, 1, CV_64FC3, cv::Scalar(0.7, 0.8, 0.9));
+  haze::HazeModel model(transmission, atmospheric_light);
+  cv::Mat hazy_image(9, 11, CV_8UC3);
+  cv::randu(hazy_image, cv::Scalar::all(0), cv::Scalar::all(256));
+  cv::Mat unpacked;
+  hazy_image.convertTo(unpacked, CV_64FC3, 1.0 / 255.0);
+  cv::Mat recovered(9, 11, CV_64FC3);
+  model.RecoverImage(recovered, unpacked);
+  cv::Mat ideal;
+  recovered.convertTo(ideal, CV_8UC3, 255.);
+  cv::Mat packed(9, 11, CV_8UC3);
+  model.RecoverImage(packed, hazy_image);
+  CHECK(cv::norm(packed, ideal, cv::NORM_INF) <= 1);
+  cv::Mat mixed(9, 11, CV_64FC3);
+  CHECK_THROWS_WITH_AS(model.RecoverImage(mixed, hazy_image),
+                       "HazeModel::RecoverImage(...): incorrect type of result",
+                       const std::invalid_argument&);
+}
+
+TEST_CASE("planar images") {
+  cv::Mat transmission(6, 10, CV_64FC1);
+  cv::randu(transmission, cv::Scalar(0.05), cv::Scalar(1.0));
+  cv::Mat atmospheric_light(1, 1, CV_64FC3, cv::Scalar(0.7, 0.8, 0.9));
+  haze::HazeModel model(transmission, atmospheric_light);
+  cv::Mat image(6, 10, CV_64FC3);
+  cv::randu(image, cv::Scalar::all(0), cv::Scalar::all(1));
+  planar::Image planar_image(image);
+  planar::Image planar_result(image.size(), 3);
+  cv::Mat result(image.size(), CV_64FC3);
+  model.RecoverImage(result, image);
+  model.RecoverImage(planar_result, planar_image);
+  CHECK(cv::norm(planar_result.ToMat(), result, cv::NORM_INF) == 0);
+  model.AugmentImage(result, image);
+  model.AugmentImage(planar_result, planar_image);
+  CHECK(cv::norm(planar_result.ToMat(), result, cv::NORM_INF) == 0);
+  planar::Image wrong_size(cv::Size(5, 6), 3);
+  CHECK_THROWS_WITH_AS(model.RecoverImage(wrong_size, planar_image),
+                       "HazeModel::RecoverImage(...): incorrect size of result",
+                       const std::invalid_argument&);
+}
@@ -3,6 +3,7 @@
 #include <math.h>
 
 #include <haze_model.hpp>
+#include <opencv2/core.hpp>
 
 static bool IsDoubleMatsEqual(const cv::Mat& lhs, const cv::Mat& rhs) {
   // (hypothesis) it seems that in OpenCV cv::compare is breaked for zero filled
@@ -51,3 +52,35 @@ TEST_CASE("1x2 matrix") {
   ideal.at<double>(0, 1) = 1.0;
   CHECK(IsDoubleMatsEqual(transmission, ideal));
 }
+
+TEST_CASE("integer depth maps") {
+  cv::Mat depth_8u(7, 9, CV_8UC1);
+  cv::randu(depth_8u, cv::Scalar(20), cv::Scalar(200));
+  cv::Mat depth_16u;
+  depth_8u.convertTo(depth_16u, CV_16UC1, 257.0);
+  cv::Mat depth;
+  depth_8u.convertTo(depth, CV_64FC1, 1.0 / 255.0);
+  double beta = 2.1;
+  cv::Mat ideal(depth.size(), CV_64FC1);
+  haze::CreateTransmission(ideal, depth, beta);
+  cv::Mat transmission(depth.size(), CV_64FC1);
+  REQUIRE_NOTHROW(haze::CreateTransmission(transmission, depth_8u, beta));
+  CHECK(cv::norm(transmission, ideal, cv::NORM_INF) < 1e-12);
+  REQUIRE_NOTHROW(haze::CreateTransmission(transmission, depth_16u, beta));
+  CHECK(cv::norm(transmission, ideal, cv::NORM_INF) < 1e-12);
+  cv::Mat transmission_32f(depth.size(), CV_32FC1);
+  CHECK_THROWS_WITH_AS(
+      haze::CreateTransmission(transmission_32f, depth_8u, beta),
+      "CreateTransmission(...): incorrect types of matrices",
+      const std::invalid_argument&);
+  cv::Mat transmission_8u(depth.size(), CV_8UC1);
+  CHECK_THROWS_WITH_AS(
+      haze::CreateTransmission(transmission_8u, depth_8u, beta),
+      "CreateTransmission(...): incorrect types of matrices",
+      const std::invalid_argument&);
+  cv::Mat transmission_16u(depth.size(), CV_16UC1);
+  CHECK_THROWS_WITH_AS(
+      haze::CreateTransmission(transmission_16u, depth_16u, beta),
+      "CreateTransmission(...): incorrect types of matrices",
+      const std::invalid_argument&);
+}
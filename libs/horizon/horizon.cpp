@@ -0,0 +1,76 @@
+#include <horizon.hpp>
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+#include <stdexcept>
+#include <vector>
+
+namespace horizon {
+
+cv::Mat SkyMask(const cv::Mat& image) {
+  cv::Mat image_8u;
+  if (image.type() == CV_64FC3)
+    image.convertTo(image_8u, CV_8UC3, 255.);
+  else if (image.type() == CV_8UC3)
+    image_8u = image;
+  else
+    throw std::invalid_argument("SkyMask(...): image has incorrect type");
+  cv::Mat gray;
+  cv::cvtColor(image_8u, gray, cv::COLOR_BGR2GRAY);
+  cv::Mat blur;
+  cv::GaussianBlur(gray, blur, cv::Size(51, 51), 0);
+  cv::Mat binary;
+  cv::threshold(blur, binary, 0, 255, cv::THRESH_BINARY | cv::THRESH_OTSU);
+  cv::Mat labels;
+  cv::Mat stats;
+  cv::Mat centroids;
+  int num_labels =
+      cv::connectedComponentsWithStats(binary, labels, stats, centroids, 4,
+                                       CV_32S);
+  int sky = -1;
+  int max_area = 0;
+  for (int i = 1; i < num_labels; ++i) {
+    int area = stats.at<int>(i, cv::CC_STAT_AREA);
+    if (area > max_area) {
+      max_area = area;
+      sky = i;
+    }
+  }
+  cv::Mat mask;
+  cv::compare(labels, sky, mask, cv::CMP_EQ);
+  return mask;
+}
+
+cv::Mat DepthFromSky(const cv::Mat& sky_mask) {
+  if (sky_mask.type() != CV_8UC1)
+    throw std::invalid_argument("DepthFromSky(...): mask has incorrect type");
+  if (sky_mask.empty())
+    throw std::invalid_argument("DepthFromSky(...): mask is empty");
+  const int rows = sky_mask.rows;
+  const int cols = sky_mask.cols;
+  // rows are scanned bottom-up and every row updates all columns at once, so
+  // the inner loops run over contiguous memory and vectorize
+  std::vector<int> horizon(cols, -1);
+  for (int r = 0; r < rows; ++r) {
+    const unsigned char* row = sky_mask.ptr<unsigned char>(rows - 1 - r);
+    for (int c = 0; c < cols; ++c)
+      horizon[c] = (horizon[c] < 0 && row[c] != 0) ? r : horizon[c];
+  }
+  std::vector<double> inv_height(cols);
+  for (int c = 0; c < cols; ++c) {
+    if (horizon[c] < 0) horizon[c] = rows - 1;
+    inv_height[c] = horizon[c] > 0 ? 1.0 / horizon[c] : 0.0;
+  }
+  cv::Mat depth(sky_mask.size(), CV_64FC1);
+  for (int r = 0; r < rows; ++r) {
+    double* row = depth.ptr<double>(rows - 1 - r);
+    for (int c = 0; c < cols; ++c)
+      row[c] = r >= horizon[c] ? 1.0 : r * inv_height[c];
+  }
+  return depth;
+}
+
+cv::Mat HorizonDepth(const cv::Mat& image) {
+  return DepthFromSky(SkyMask(image));
+}
+
+}  // namespace horizon
@@ -0,0 +1,22 @@
+#pragma once
+#ifndef HORIZON_HPP
+#define HORIZON_HPP
+
+#include <opencv2/core/mat.hpp>
+
+namespace horizon {
+
+// The largest 4-connected bright component of the blurred Otsu-binarized
+// image, which is the sky on horizon photos. Returns CV_8UC1 with 255 for sky.
+// image is CV_8UC3 or CV_64FC3 in [0, 1].
+cv::Mat SkyMask(const cv::Mat& image);
+
+// Pseudo-depth in [0, 1] from a sky mask: in every column depth grows linearly
+// from 0 at the bottom row to 1 at the lowest sky pixel, which and everything
+// above it is at depth 1. Columns without sky reach 1 at the top row.
+cv::Mat DepthFromSky(const cv::Mat& sky_mask);
+
+cv::Mat HorizonDepth(const cv::Mat& image);
+
+}  // namespace horizon
+#endif  // HORIZON_HPP
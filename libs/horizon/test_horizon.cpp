@@ -0,0 +1,42 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <doctest.h>
+
+#include <opencv2/core.hpp>
+#include <stdexcept>
+
+#include "horizon.hpp"
+
+TEST_CASE("DepthFromSky") {
+  // column 0 has sky from row 1 up, column 1 has sky only at the bottom row,
+  // column 2 has no sky
+  cv::Mat mask(5, 3, CV_8UC1, cv::Scalar(0));
+  mask.at<unsigned char>(0, 0) = 255;
+  mask.at<unsigned char>(1, 0) = 255;
+  mask.at<unsigned char>(4, 1) = 255;
+  cv::Mat depth = horizon::DepthFromSky(mask);
+  REQUIRE_EQ(depth.type(), CV_64FC1);
+  CHECK_EQ(depth.at<double>(4, 0), 0.0);
+  CHECK(depth.at<double>(3, 0) == doctest::Approx(1.0 / 3));
+  CHECK(depth.at<double>(2, 0) == doctest::Approx(2.0 / 3));
+  CHECK_EQ(depth.at<double>(1, 0), 1.0);
+  CHECK_EQ(depth.at<double>(0, 0), 1.0);
+  for (int r = 0; r < 5; ++r) CHECK_EQ(depth.at<double>(r, 1), 1.0);
+  for (int r = 0; r < 5; ++r)
+    CHECK(depth.at<double>(r, 2) == doctest::Approx((4 - r) / 4.0));
+  REQUIRE_THROWS_WITH_AS(horizon::DepthFromSky(cv::Mat(2, 2, CV_64FC1)),
+                         "DepthFromSky(...): mask has incorrect type",
+                         const std::invalid_argument&);
+}
+
+TEST_CASE("HorizonDepth") {
+  // bright sky over a dark ground
+  cv::Mat image(120, 80, CV_64FC3, cv::Scalar(0.1, 0.1, 0.1));
+  image(cv::Rect(0, 0, 80, 50)).setTo(cv::Scalar(0.9, 0.9, 0.9));
+  cv::Mat sky = horizon::SkyMask(image);
+  CHECK_EQ(sky.at<unsigned char>(0, 40), 255);
+  CHECK_EQ(sky.at<unsigned char>(119, 40), 0);
+  cv::Mat depth = horizon::HorizonDepth(image);
+  CHECK_EQ(depth.at<double>(0, 40), 1.0);
+  CHECK_EQ(depth.at<double>(119, 40), 0.0);
+  CHECK(depth.at<double>(90, 40) < depth.at<double>(70, 40));
+}
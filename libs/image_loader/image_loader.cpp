@@ -2,6 +2,9 @@
 #include <fstream>
 #include <image_loader.hpp>
 #include <iterator>
+#include <memory>
+#include <npy/npy.hpp>
+#include <opencv2/core.hpp>
 #include <opencv2/imgcodecs.hpp>
 #include <vector>
 
@@ -34,6 +37,14 @@ std::vector<PathWrapper> LoadDir(const PathWrapper& path) {
 }
 
 cv::Mat LoadImg(const PathWrapper& path) {
+  cv::Mat result = LoadPackedImg(path);
+  // converting img to right format
+  cv::Mat right_result;
+  result.convertTo(right_result, CV_64FC3, 1.0 / 255.0);
+  return right_result;
+}
+
+cv::Mat LoadPackedImg(const PathWrapper& path) {
   cv::Mat result = cv::imread(path.ToString());
   if (result.empty()) {
     result = LoadImgUTF8(path);
@@ -41,13 +52,10 @@ cv::Mat LoadImg(const PathWrapper& path) {
   if (result.empty()) {
     throw std::runtime_error("LoadImg(...): a path isn't Unicode");
   }
-  // converting img to right format
-  cv::Mat right_result;
-  result.convertTo(right_result, CV_64FC3, 1.0 / 255.0);
-  return right_result;
+  return result;
 }
 
-cv::Mat LoadImgUTF8(const PathWrapper& path) {
+cv::Mat LoadImgUTF8(const PathWrapper& path, const int flags) {
   std::ifstream file(path.path, std::ios::binary);
   file.unsetf(std::ios::skipws);
 
@@ -60,7 +68,44 @@ cv::Mat LoadImgUTF8(const PathWrapper& path) {
   img_vec.reserve(size);
   img_vec.insert(img_vec.begin(), std::istream_iterator<unsigned char>(file),
                  std::istream_iterator<unsigned char>());
-  return cv::imdecode(img_vec, cv::IMREAD_COLOR);
+  return cv::imdecode(img_vec, flags);
+}
+
+cv::Mat LoadDepth(const PathWrapper& path) {
+  cv::Mat raw;
+  std::unique_ptr<npy::Array> array;
+  if (path.path.extension() == ".npy") {
+    array.reset(new npy::Array(path.ToString()));
+    raw = array->Image();
+  } else {
+    raw = cv::imread(path.ToString(), cv::IMREAD_ANYDEPTH);
+    if (raw.empty()) raw = LoadImgUTF8(path, cv::IMREAD_ANYDEPTH);
+  }
+  if (raw.empty())
+    throw std::runtime_error("LoadDepth(...): cannot read depth map");
+  if (raw.channels() != 1)
+    throw std::runtime_error("LoadDepth(...): depth map isn't single-channel");
+  double scale = 1.0;
+  switch (raw.depth()) {
+    case CV_8U:
+      scale = 1.0 / 255.0;
+      break;
+    case CV_16U:
+      scale = 1.0 / 65535.0;
+      break;
+    case CV_32F:
+    case CV_64F: {
+      double max = 0;
+      cv::minMaxLoc(raw, nullptr, &max);
+      if (max > 1.0) scale = 1.0 / max;
+      break;
+    }
+    default:
+      throw std::runtime_error("LoadDepth(...): unsupported depth map type");
+  }
+  cv::Mat result;
+  raw.convertTo(result, CV_64FC1, scale);
+  return result;
 }
 
 }  // namespace load
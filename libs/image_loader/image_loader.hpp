@@ -4,6 +4,7 @@
 
 #include <filesystem>
 #include <opencv2/core/mat.hpp>
+#include <opencv2/imgcodecs.hpp>
 #include <vector>
 
 namespace fs = std::filesystem;
@@ -33,7 +34,18 @@ struct PathWrapper {
 
 cv::Mat LoadImg(const PathWrapper& path);
 
-cv::Mat LoadImgUTF8(const PathWrapper& path);
+// The decoded CV_8UC3 image without conversion to CV_64FC3.
+cv::Mat LoadPackedImg(const PathWrapper& path);
+
+cv::Mat LoadImgUTF8(const PathWrapper& path,
+                    const int flags = cv::IMREAD_COLOR);
+
+// Loads a depth map into CV_64FC1 without 8-bit quantization: 8/16-bit PNG,
+// TIFF and float EXR through OpenCV (color maps are converted to gray) or
+// .npy arrays through a memory mapping. Integer maps are scaled by the
+// maximum of their type, float maps are kept unless they exceed 1, then they
+// are divided by their maximum.
+cv::Mat LoadDepth(const PathWrapper& path);
 
 std::vector<PathWrapper> LoadDir(const PathWrapper& path);
 
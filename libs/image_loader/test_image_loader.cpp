@@ -1,6 +1,10 @@
 #define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
 #include <doctest.h>
 
+#include <fstream>
+#include <opencv2/core.hpp>
+#include <opencv2/imgcodecs.hpp>
+
 #include "image_loader.hpp"
 
 TEST_CASE("ImageLoader") {
@@ -16,3 +20,39 @@ TEST_CASE("LoadImg") {
   load::PathWrapper input(std::string(CSDIR) + "/test_dir");
   std::vector<load::PathWrapper> result;
 }
+
+TEST_CASE("LoadDepth") {
+  fs::path dir = fs::temp_directory_path() / "test_image_loader_depth";
+  fs::remove_all(dir);
+  fs::create_directories(dir);
+  cv::Mat depth(4, 6, CV_16UC1);
+  for (int i = 0; i < depth.rows; ++i)
+    for (int j = 0; j < depth.cols; ++j)
+      depth.at<uint16_t>(i, j) = static_cast<uint16_t>(1000 * i + 7 * j);
+  cv::imwrite((dir / "depth.png").string(), depth);
+  cv::Mat result =
+      load::LoadDepth(load::PathWrapper((dir / "depth.png").string()));
+  REQUIRE_EQ(result.type(), CV_64FC1);
+  // 16-bit steps survive, 8-bit quantization would merge them
+  CHECK(result.at<double>(3, 5) == doctest::Approx(3035.0 / 65535.0));
+  CHECK(result.at<double>(0, 1) == doctest::Approx(7.0 / 65535.0));
+
+  float values[4] = {1.f, 2.f, 4.f, 8.f};
+  std::string header =
+      "{'descr': '<f4', 'fortran_order': False, 'shape': (2, 2), }";
+  while ((10 + header.size() + 1) % 64 != 0) header += ' ';
+  header += '\n';
+  {
+    std::ofstream file(dir / "depth.npy", std::ios::binary);
+    file.write("\x93NUMPY\x01\x00", 8);
+    file.put(static_cast<char>(header.size()));
+    file.put(0);
+    file << header;
+    file.write(reinterpret_cast<const char*>(values), sizeof(values));
+  }
+  result = load::LoadDepth(load::PathWrapper((dir / "depth.npy").string()));
+  REQUIRE_EQ(result.size(), cv::Size(2, 2));
+  CHECK(result.at<double>(0, 0) == doctest::Approx(0.125));
+  CHECK(result.at<double>(1, 1) == doctest::Approx(1.0));
+  fs::remove_all(dir);
+}
@@ -0,0 +1,143 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <metrics.hpp>
+#include <opencv2/core.hpp>
+#include <sat/sat.hpp>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace fs = std::filesystem;
+
+namespace metrics {
+
+static void CheckPair(const cv::Mat& lhs, const cv::Mat& rhs,
+                      const std::string& func) {
+  if (lhs.empty() || rhs.empty())
+    throw std::invalid_argument(func + "(...): image is empty");
+  if (lhs.size() != rhs.size() || lhs.channels() != rhs.channels())
+    throw std::invalid_argument(func + "(...): images have different shapes");
+}
+
+static cv::Mat ToDouble(const cv::Mat& image) {
+  cv::Mat result;
+  image.convertTo(result, CV_MAKETYPE(CV_64F, image.channels()));
+  return result;
+}
+
+double MSE(const cv::Mat& lhs, const cv::Mat& rhs) {
+  CheckPair(lhs, rhs, "MSE");
+  cv::Mat diff = ToDouble(lhs) - ToDouble(rhs);
+  cv::Scalar sum = cv::sum(diff.mul(diff));
+  double total = sum[0] + sum[1] + sum[2] + sum[3];
+  return total / (static_cast<double>(lhs.total()) * lhs.channels());
+}
+
+static double PSNRFromMSE(const double mse, const double data_range) {
+  if (data_range <= 0)
+    throw std::invalid_argument("PSNR(...): data range must be positive");
+  if (mse == 0) return std::numeric_limits<double>::infinity();
+  return 10.0 * std::log10(data_range * data_range / mse);
+}
+
+double PSNR(const cv::Mat& lhs, const cv::Mat& rhs, const double data_range) {
+  return PSNRFromMSE(MSE(lhs, rhs), data_range);
+}
+
+double SSIM(const cv::Mat& lhs, const cv::Mat& rhs, const double data_range,
+            const int win_size) {
+  CheckPair(lhs, rhs, "SSIM");
+  if (data_range <= 0)
+    throw std::invalid_argument("SSIM(...): data range must be positive");
+  if (win_size < 3 || win_size % 2 == 0)
+    throw std::invalid_argument("SSIM(...): window size is incorrect");
+  if (lhs.rows < win_size || lhs.cols < win_size)
+    throw std::invalid_argument("SSIM(...): image is smaller than window");
+  const double c1 = std::pow(0.01 * data_range, 2);
+  const double c2 = std::pow(0.03 * data_range, 2);
+  const double np = static_cast<double>(win_size) * win_size;
+  const double cov_norm = np / (np - 1);
+  // only windows inside the image are averaged, so no border is needed; each
+  // table holds all channels, the per-pixel map is averaged later
+  int pad = (win_size - 1) / 2;
+  cv::Rect inner(pad, pad, lhs.cols - 2 * pad, lhs.rows - 2 * pad);
+  auto mean = [&](const cv::Mat& src) {
+    return sat::Table(src).BoxMean(win_size, inner);
+  };
+  cv::Mat x = ToDouble(lhs);
+  cv::Mat y = ToDouble(rhs);
+  cv::Mat ux = mean(x);
+  cv::Mat uy = mean(y);
+  cv::Mat uxx = mean(x.mul(x));
+  cv::Mat uyy = mean(y.mul(y));
+  cv::Mat uxy = mean(x.mul(y));
+  cv::Mat ux_uy = ux.mul(uy);
+  cv::Mat ux2 = ux.mul(ux);
+  cv::Mat uy2 = uy.mul(uy);
+  cv::Mat vx = cov_norm * (uxx - ux2);
+  cv::Mat vy = cov_norm * (uyy - uy2);
+  cv::Mat vxy = cov_norm * (uxy - ux_uy);
+  cv::Mat a = (2 * ux_uy + c1).mul(2 * vxy + c2);
+  cv::Mat b = (ux2 + uy2 + c1).mul(vx + vy + c2);
+  cv::Mat s;
+  cv::divide(a, b, s);
+  cv::Scalar channel_means = cv::mean(s);
+  double total = 0;
+  for (int c = 0; c < s.channels(); ++c) total += channel_means[c];
+  return total / s.channels();
+}
+
+Scores Compare(const cv::Mat& lhs, const cv::Mat& rhs,
+               const double data_range) {
+  Scores scores;
+  scores.mse = MSE(lhs, rhs);
+  scores.psnr = PSNRFromMSE(scores.mse, data_range);
+  scores.ssim = SSIM(lhs, rhs, data_range);
+  return scores;
+}
+
+Scores CompareAs8Bit(const cv::Mat& lhs, const cv::Mat& rhs) {
+  Scores scores = Compare(lhs, rhs, 1.0);
+  scores.mse *= 255.0 * 255.0;
+  return scores;
+}
+
+static bool IsDiagnostic(const std::string& name) {
+  return name.find("_tr") != std::string::npos ||
+         name.find("_dc") != std::string::npos;
+}
+
+std::vector<fs::path> CollectImages(const fs::path& dir) {
+  if (!fs::exists(dir))
+    throw std::runtime_error("CollectImages(...): path doesn't exist");
+  if (!fs::is_directory(dir))
+    throw std::runtime_error("CollectImages(...): path isn't a dir");
+  std::vector<fs::path> result;
+  for (const auto& entry : fs::recursive_directory_iterator{dir}) {
+    if (entry.is_directory()) continue;
+    if (IsDiagnostic(entry.path().filename().u8string())) continue;
+    result.push_back(entry.path());
+  }
+  std::sort(result.begin(), result.end());
+  return result;
+}
+
+std::vector<std::pair<fs::path, fs::path>> PairByName(const fs::path& lhs_dir,
+                                                      const fs::path& rhs_dir) {
+  std::vector<fs::path> lhs_images = CollectImages(lhs_dir);
+  std::unordered_map<std::string, fs::path> rhs_images;
+  for (auto& path : CollectImages(rhs_dir))
+    rhs_images.emplace(path.filename().u8string(), path);
+  std::vector<std::pair<fs::path, fs::path>> result;
+  result.reserve(lhs_images.size());
+  for (auto& path : lhs_images) {
+    auto it = rhs_images.find(path.filename().u8string());
+    if (it == rhs_images.end())
+      throw std::runtime_error("PairByName(...): no pair for " +
+                               path.filename().u8string());
+    result.emplace_back(path, it->second);
+  }
+  return result;
+}
+
+}  // namespace metrics
@@ -0,0 +1,51 @@
+#pragma once
+#ifndef METRICS_HPP
+#define METRICS_HPP
+
+#include <filesystem>
+#include <opencv2/core/mat.hpp>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace metrics {
+
+struct Scores {
+  double mse = 0;
+  double psnr = 0;
+  double ssim = 0;
+};
+
+// Images must have equal size and number of channels; data_range is the
+// distance between the minimal and maximal possible values (255 for 8-bit
+// images, 1 for images in [0, 1]). MSE is measured in the image units.
+double MSE(const cv::Mat& lhs, const cv::Mat& rhs);
+
+double PSNR(const cv::Mat& lhs, const cv::Mat& rhs, const double data_range);
+
+// Mean structural similarity with a uniform window of win_size x win_size,
+// averaged over channels. Matches skimage.metrics.structural_similarity with
+// default arguments (sample covariance, reflected borders cropped out).
+double SSIM(const cv::Mat& lhs, const cv::Mat& rhs, const double data_range,
+            const int win_size = 7);
+
+Scores Compare(const cv::Mat& lhs, const cv::Mat& rhs,
+               const double data_range);
+
+// Scores of images in [0, 1] on the 8-bit scale of haze_compare and
+// comparator.py: MSE is that of the images multiplied by 255, PSNR and SSIM
+// don't depend on the scale.
+Scores CompareAs8Bit(const cv::Mat& lhs, const cv::Mat& rhs);
+
+// Files of the directory tree, except dark channel (_dc) and transmission
+// (_tr) images written by HazeMachine.
+std::vector<std::filesystem::path> CollectImages(
+    const std::filesystem::path& dir);
+
+// Pairs every lhs image with the rhs image of the same file name.
+std::vector<std::pair<std::filesystem::path, std::filesystem::path>>
+PairByName(const std::filesystem::path& lhs_dir,
+           const std::filesystem::path& rhs_dir);
+
+}  // namespace metrics
+#endif  // METRICS_HPP
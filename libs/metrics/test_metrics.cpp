@@ -0,0 +1,96 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <doctest.h>
+
+#include <cmath>
+#include <fstream>
+#include <opencv2/core.hpp>
+
+#include "metrics.hpp"
+
+namespace fs = std::filesystem;
+
+TEST_CASE("MSE and PSNR") {
+  cv::Mat lhs(16, 16, CV_8UC3, cv::Scalar(100, 100, 100));
+  cv::Mat rhs(16, 16, CV_8UC3, cv::Scalar(110, 100, 90));
+  CHECK(metrics::MSE(lhs, rhs) == doctest::Approx(200.0 / 3));
+  CHECK(metrics::PSNR(lhs, rhs, 255) ==
+        doctest::Approx(10 * std::log10(255.0 * 255.0 * 3 / 200)));
+  CHECK(std::isinf(metrics::PSNR(lhs, lhs, 255)));
+  cv::Mat other(8, 16, CV_8UC3);
+  REQUIRE_THROWS_WITH_AS(metrics::MSE(lhs, other),
+                         "MSE(...): images have different shapes",
+                         const std::invalid_argument&);
+}
+
+TEST_CASE("8-bit scale of unit images") {
+  cv::Mat lhs(16, 16, CV_64FC3, cv::Scalar::all(0.5));
+  cv::Mat rhs(16, 16, CV_64FC3, cv::Scalar::all(0.6));
+  metrics::Scores scores = metrics::CompareAs8Bit(lhs, rhs);
+  // (0.1 * 255)^2 and 10 * log10(255^2 / 650.25)
+  CHECK(scores.mse == doctest::Approx(650.25));
+  CHECK(scores.psnr == doctest::Approx(20.0));
+  // constant images: (2 * 0.5 * 0.6 + c1) / (0.5^2 + 0.6^2 + c1), c1 = 1e-4
+  CHECK(scores.ssim == doctest::Approx(0.6001 / 0.6101));
+  cv::Mat ui_lhs(16, 16, CV_8UC3, cv::Scalar::all(100));
+  cv::Mat ui_rhs(16, 16, CV_8UC3, cv::Scalar::all(110));
+  cv::Mat unit_lhs;
+  cv::Mat unit_rhs;
+  ui_lhs.convertTo(unit_lhs, CV_64FC3, 1 / 255.0);
+  ui_rhs.convertTo(unit_rhs, CV_64FC3, 1 / 255.0);
+  metrics::Scores ideal = metrics::Compare(ui_lhs, ui_rhs, 255);
+  scores = metrics::CompareAs8Bit(unit_lhs, unit_rhs);
+  CHECK(scores.mse == doctest::Approx(ideal.mse));
+  CHECK(scores.psnr == doctest::Approx(ideal.psnr));
+  CHECK(scores.ssim == doctest::Approx(ideal.ssim));
+}
+
+TEST_CASE("SSIM") {
+  cv::Mat image(64, 64, CV_64FC3);
+  cv::RNG rng(42);
+  rng.fill(image, cv::RNG::UNIFORM, 0.0, 1.0);
+  CHECK(metrics::SSIM(image, image, 1.0) == doctest::Approx(1.0));
+
+  cv::Mat noise(image.size(), image.type());
+  rng.fill(noise, cv::RNG::NORMAL, 0.0, 0.05);
+  cv::Mat slightly_noisy = image + noise;
+  cv::Mat very_noisy = image + 4 * noise;
+  double slight = metrics::SSIM(image, slightly_noisy, 1.0);
+  double strong = metrics::SSIM(image, very_noisy, 1.0);
+  CHECK(slight < 1.0);
+  CHECK(strong < slight);
+  CHECK(metrics::SSIM(slightly_noisy, image, 1.0) == doctest::Approx(slight));
+
+  // uint8 images give the same score as their [0, 1] copies
+  cv::Mat ui_image;
+  cv::Mat ui_noisy;
+  image.convertTo(ui_image, CV_8UC3, 255);
+  slightly_noisy.convertTo(ui_noisy, CV_8UC3, 255);
+  cv::Mat image_back;
+  cv::Mat noisy_back;
+  ui_image.convertTo(image_back, CV_64FC3, 1 / 255.0);
+  ui_noisy.convertTo(noisy_back, CV_64FC3, 1 / 255.0);
+  CHECK(metrics::SSIM(ui_image, ui_noisy, 255) ==
+        doctest::Approx(metrics::SSIM(image_back, noisy_back, 1.0)));
+  REQUIRE_THROWS_WITH_AS(metrics::SSIM(image, image, 1.0, 4),
+                         "SSIM(...): window size is incorrect",
+                         const std::invalid_argument&);
+}
+
+TEST_CASE("PairByName") {
+  fs::path root = fs::temp_directory_path() / "test_metrics_pairs";
+  fs::remove_all(root);
+  fs::create_directories(root / "lhs" / "sub");
+  fs::create_directories(root / "rhs");
+  for (const auto& path :
+       {root / "lhs" / "a.png", root / "lhs" / "sub" / "b.png",
+        root / "lhs" / "a_dc.png", root / "rhs" / "a.png",
+        root / "rhs" / "b.png", root / "rhs" / "c.png"})
+    std::ofstream(path) << "x";
+  auto pairs = metrics::PairByName(root / "lhs", root / "rhs");
+  REQUIRE_EQ(pairs.size(), 2);
+  for (const auto& [lhs, rhs] : pairs)
+    CHECK_EQ(lhs.filename(), rhs.filename());
+  REQUIRE_THROWS_AS(metrics::PairByName(root / "rhs", root / "lhs"),
+                    const std::runtime_error&);
+  fs::remove_all(root);
+}
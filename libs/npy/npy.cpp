@@ -0,0 +1,198 @@
+#include <cstring>
+#include <fstream>
+#include <npy.hpp>
+#include <opencv2/core.hpp>
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace npy {
+
+#ifdef _WIN32
+MappedFile::MappedFile(const std::string& path) {
+  file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                     OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (file == INVALID_HANDLE_VALUE)
+    throw std::runtime_error("MappedFile::MappedFile(...): cannot open file");
+  LARGE_INTEGER file_size;
+  GetFileSizeEx(file, &file_size);
+  size = static_cast<size_t>(file_size.QuadPart);
+  if (size == 0) {
+    CloseHandle(file);
+    throw std::runtime_error("MappedFile::MappedFile(...): file is empty");
+  }
+  mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (mapping != nullptr)
+    data = static_cast<const unsigned char*>(
+        MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+  if (data == nullptr) {
+    if (mapping != nullptr) CloseHandle(mapping);
+    CloseHandle(file);
+    throw std::runtime_error("MappedFile::MappedFile(...): cannot map file");
+  }
+}
+
+MappedFile::~MappedFile() {
+  UnmapViewOfFile(data);
+  CloseHandle(mapping);
+  CloseHandle(file);
+}
+#else
+MappedFile::MappedFile(const std::string& path) {
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    throw std::runtime_error("MappedFile::MappedFile(...): cannot open file");
+  struct stat info;
+  if (fstat(fd, &info) != 0 || info.st_size == 0) {
+    close(fd);
+    throw std::runtime_error("MappedFile::MappedFile(...): file is empty");
+  }
+  size = static_cast<size_t>(info.st_size);
+  void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (mapped == MAP_FAILED)
+    throw std::runtime_error("MappedFile::MappedFile(...): cannot map file");
+  data = static_cast<const unsigned char*>(mapped);
+}
+
+MappedFile::~MappedFile() {
+  munmap(const_cast<unsigned char*>(data), size);
+}
+#endif
+
+static std::string HeaderValue(const std::string& header,
+                               const std::string& key) {
+  size_t pos = header.find("'" + key + "'");
+  if (pos == std::string::npos)
+    throw std::runtime_error("Array::Array(...): header has no " + key);
+  pos = header.find(':', pos);
+  if (pos == std::string::npos)
+    throw std::runtime_error("Array::Array(...): header is corrupted");
+  ++pos;
+  while (pos < header.size() && header[pos] == ' ') ++pos;
+  size_t end = header[pos] == '(' ? header.find(')', pos) + 1
+                                  : header.find_first_of(",}", pos);
+  return header.substr(pos, end - pos);
+}
+
+static int ParseDepth(const std::string& descr) {
+  // descr is quoted, e.g. '<f4'
+  std::string type = descr.substr(1, descr.size() - 2);
+  if (type == "|b1" || type == "|u1") return CV_8U;
+  if (type == "<u2") return CV_16U;
+  if (type == "<i4") return CV_32S;
+  if (type == "<f2") return CV_16F;
+  if (type == "<f4") return CV_32F;
+  if (type == "<f8") return CV_64F;
+  throw std::runtime_error("Array::Array(...): unsupported dtype " + type);
+}
+
+Array::Array(const std::string& path) : file(path) {
+  const unsigned char* data = file.Data();
+  static const char magic[] = "\x93NUMPY";
+  if (file.Size() < 10 || std::memcmp(data, magic, 6) != 0)
+    throw std::runtime_error("Array::Array(...): file isn't npy");
+  size_t header_size = 0;
+  size_t header_offset = 0;
+  if (data[6] == 1) {
+    header_size = data[8] | (data[9] << 8);
+    header_offset = 10;
+  } else if (file.Size() >= 12 && (data[6] == 2 || data[6] == 3)) {
+    header_size = data[8] | (data[9] << 8) | (data[10] << 16) |
+                  (static_cast<size_t>(data[11]) << 24);
+    header_offset = 12;
+  } else {
+    throw std::runtime_error("Array::Array(...): unsupported npy version");
+  }
+  data_offset = header_offset + header_size;
+  if (data_offset > file.Size())
+    throw std::runtime_error("Array::Array(...): header is corrupted");
+  std::string header(reinterpret_cast<const char*>(data) + header_offset,
+                     header_size);
+  if (HeaderValue(header, "fortran_order") != "False")
+    throw std::runtime_error(
+        "Array::Array(...): fortran order isn't supported");
+  depth = ParseDepth(HeaderValue(header, "descr"));
+  std::string dims = HeaderValue(header, "shape");
+  size_t total = 1;
+  for (size_t pos = 1; pos < dims.size();) {
+    size_t end = dims.find_first_of(",)", pos);
+    std::string dim = dims.substr(pos, end - pos);
+    if (dim.find_first_not_of(' ') != std::string::npos) {
+      shape.push_back(std::stoull(dim));
+      total *= shape.back();
+    }
+    pos = end + 1;
+  }
+  if (data_offset + total * CV_ELEM_SIZE(depth) > file.Size())
+    throw std::runtime_error("Array::Array(...): file is truncated");
+}
+
+cv::Mat Array::Image() const {
+  std::vector<size_t> dims;
+  for (size_t dim : shape)
+    if (dim != 1) dims.push_back(dim);
+  if (dims.size() > 2)
+    throw std::runtime_error("Array::Image(): array isn't an image");
+  while (dims.size() < 2) dims.insert(dims.begin(), 1);
+  return cv::Mat(static_cast<int>(dims[0]), static_cast<int>(dims[1]),
+                 CV_MAKETYPE(depth, 1),
+                 const_cast<unsigned char*>(file.Data() + data_offset));
+}
+
+void Write(const std::string& path, const cv::Mat& image) {
+  if (image.channels() != 1)
+    throw std::invalid_argument("Write(...): image must be single-channel");
+  std::string descr;
+  switch (image.depth()) {
+    case CV_8U:
+      descr = "|u1";
+      break;
+    case CV_16U:
+      descr = "<u2";
+      break;
+    case CV_32S:
+      descr = "<i4";
+      break;
+    case CV_16F:
+      descr = "<f2";
+      break;
+    case CV_32F:
+      descr = "<f4";
+      break;
+    case CV_64F:
+      descr = "<f8";
+      break;
+    default:
+      throw std::invalid_argument("Write(...): unsupported image type");
+  }
+  std::string header = "{'descr': '" + descr +
+                       "', 'fortran_order': False, 'shape': (" +
+                       std::to_string(image.rows) + ", " +
+                       std::to_string(image.cols) + "), }";
+  // the data starts at a multiple of 64 bytes, as numpy aligns it
+  header.append(63 - (10 + header.size()) % 64, ' ');
+  header += '\n';
+  std::ofstream file(path, std::ios::binary);
+  file.write("\x93NUMPY\x01\x00", 8);
+  file.put(static_cast<char>(header.size() & 0xff));
+  file.put(static_cast<char>(header.size() >> 8));
+  file.write(header.data(), header.size());
+  size_t row_size = image.cols * image.elemSize();
+  if (image.isContinuous())
+    file.write(reinterpret_cast<const char*>(image.data),
+               row_size * image.rows);
+  else
+    for (int i = 0; i < image.rows; ++i)
+      file.write(reinterpret_cast<const char*>(image.ptr(i)), row_size);
+  if (!file) throw std::runtime_error("Write(...): cannot write file");
+}
+
+}  // namespace npy
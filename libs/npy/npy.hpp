@@ -0,0 +1,67 @@
+#pragma once
+#ifndef NPY_HPP
+#define NPY_HPP
+
+#include <cstddef>
+#include <opencv2/core/mat.hpp>
+#include <string>
+#include <vector>
+
+namespace npy {
+
+// Read-only memory mapping of a whole file.
+class MappedFile {
+ public:
+  MappedFile() = delete;
+  MappedFile(const MappedFile&) = delete;
+  MappedFile(MappedFile&&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+  MappedFile& operator=(MappedFile&&) = delete;
+  explicit MappedFile(const std::string& path);
+  ~MappedFile();
+  const unsigned char* Data() const { return data; }
+  size_t Size() const { return size; }
+
+ private:
+  const unsigned char* data = nullptr;
+  size_t size = 0;
+#ifdef _WIN32
+  void* file = nullptr;
+  void* mapping = nullptr;
+#endif
+};
+
+// A C-ordered little-endian .npy array (format versions 1-3) of bool, uint8,
+// uint16, int32, float16, float32 or float64 read through a memory mapping, so
+// no data is copied until the caller converts it.
+class Array {
+ public:
+  Array() = delete;
+  Array(const Array&) = delete;
+  Array(Array&&) = delete;
+  Array& operator=(const Array&) = delete;
+  Array& operator=(Array&&) = delete;
+  explicit Array(const std::string& path);
+  ~Array() = default;
+  const std::vector<size_t>& Shape() const { return shape; }
+  // OpenCV depth of the elements, e.g. CV_32F
+  int Depth() const { return depth; }
+  // Single-channel rows x cols view over the mapping; trailing and leading
+  // dimensions of size 1 are dropped, so (h, w, 1) and (1, h, w) are images.
+  // The view is valid while the Array lives.
+  cv::Mat Image() const;
+
+ private:
+  MappedFile file;
+  std::vector<size_t> shape;
+  int depth = -1;
+  size_t data_offset = 0;
+};
+
+// Writes a single-channel uint8, uint16, int32, float16, float32 or float64
+// image as a (rows, cols) array; the data goes to the file straight from the
+// rows of the image, without an intermediate buffer.
+void Write(const std::string& path, const cv::Mat& image);
+
+}  // namespace npy
+#endif  // NPY_HPP
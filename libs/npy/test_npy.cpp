@@ -0,0 +1,92 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <doctest.h>
+
+#include <filesystem>
+#include <fstream>
+#include <opencv2/core.hpp>
+#include <stdexcept>
+
+#include "npy.hpp"
+
+namespace fs = std::filesystem;
+
+static void WriteFile(const fs::path& path, const std::string& header,
+                      const void* data, const size_t size) {
+  std::string padded = header;
+  while ((10 + padded.size() + 1) % 64 != 0) padded += ' ';
+  padded += '\n';
+  std::ofstream file(path, std::ios::binary);
+  file.write("\x93NUMPY\x01\x00", 8);
+  char header_size[2] = {static_cast<char>(padded.size() & 0xff),
+                         static_cast<char>(padded.size() >> 8)};
+  file.write(header_size, 2);
+  file.write(padded.data(), padded.size());
+  file.write(static_cast<const char*>(data), size);
+}
+
+TEST_CASE("Array") {
+  fs::path path = fs::temp_directory_path() / "test_npy.npy";
+  float values[6] = {0.5f, 1.f, 2.f, 3.f, 4.f, 350.f};
+  WriteFile(path,
+            "{'descr': '<f4', 'fortran_order': False, 'shape': (2, 3, 1), }",
+            values, sizeof(values));
+  {
+    npy::Array array(path.string());
+    REQUIRE_EQ(array.Shape().size(), 3);
+    CHECK_EQ(array.Shape()[0], 2);
+    CHECK_EQ(array.Shape()[1], 3);
+    CHECK_EQ(array.Depth(), CV_32F);
+    cv::Mat image = array.Image();
+    REQUIRE_EQ(image.type(), CV_32FC1);
+    CHECK_EQ(image.size(), cv::Size(3, 2));
+    CHECK_EQ(image.at<float>(1, 2), 350.f);
+  }
+
+  unsigned char mask[6] = {1, 0, 1, 1, 1, 0};
+  WriteFile(path, "{'descr': '|b1', 'fortran_order': False, 'shape': (2, 3), }",
+            mask, sizeof(mask));
+  {
+    npy::Array array(path.string());
+    CHECK_EQ(array.Image().type(), CV_8UC1);
+    CHECK_EQ(cv::countNonZero(array.Image()), 4);
+  }
+
+  WriteFile(path, "{'descr': '<f4', 'fortran_order': False, 'shape': (4, 3), }",
+            values, sizeof(values));
+  REQUIRE_THROWS_WITH_AS(npy::Array(path.string()),
+                         "Array::Array(...): file is truncated",
+                         const std::runtime_error&);
+  WriteFile(path, "{'descr': '<c8', 'fortran_order': False, 'shape': (3,), }",
+            values, sizeof(values));
+  REQUIRE_THROWS_AS(npy::Array(path.string()), const std::runtime_error&);
+  fs::remove(path);
+}
+
+TEST_CASE("Write") {
+  fs::path path = fs::temp_directory_path() / "test_npy_write.npy";
+  cv::Mat plane(3, 5, CV_64FC1);
+  for (int i = 0; i < plane.rows; ++i)
+    for (int j = 0; j < plane.cols; ++j) plane.at<double>(i, j) = 0.1 * i + j;
+  for (int depth : {CV_16F, CV_32F, CV_64F}) {
+    cv::Mat converted;
+    plane.convertTo(converted, depth);
+    npy::Write(path.string(), converted);
+    npy::Array array(path.string());
+    REQUIRE_EQ(array.Depth(), depth);
+    REQUIRE_EQ(array.Shape().size(), 2);
+    cv::Mat restored;
+    array.Image().convertTo(restored, CV_64F);
+    CHECK(cv::norm(restored, plane, cv::NORM_INF) < 1e-2);
+  }
+  // a view into a bigger matrix isn't continuous
+  cv::Mat big(10, 10, CV_32FC1, cv::Scalar(2));
+  npy::Write(path.string(), big(cv::Rect(1, 1, 4, 3)));
+  npy::Array array(path.string());
+  CHECK_EQ(array.Image().size(), cv::Size(4, 3));
+  CHECK_EQ(cv::norm(array.Image(), big(cv::Rect(1, 1, 4, 3)), cv::NORM_INF),
+           0.0);
+  REQUIRE_THROWS_WITH_AS(npy::Write(path.string(), cv::Mat(2, 2, CV_32FC3)),
+                         "Write(...): image must be single-channel",
+                         const std::invalid_argument&);
+  fs::remove(path);
+}
@@ -0,0 +1,52 @@
+#include <parallel.hpp>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace parallel {
+
+void ForEach(const int count, const int jobs,
+             const std::function<void(const int)>& work) {
+  if (jobs < 1)
+    throw std::invalid_argument("ForEach(...): jobs must be positive");
+  int threads = std::min(count, jobs);
+  std::atomic<int> next{0};
+  std::mutex error_mutex;
+  std::string error;
+  auto worker = [&]() {
+    for (int n = next++; n < count; n = next++) {
+      try {
+        work(n);
+      } catch (const std::exception& ex) {
+        std::lock_guard<std::mutex> lock(error_mutex);
+        if (error.empty()) error = ex.what();
+        next = count;
+      }
+    }
+  };
+  if (threads <= 1) {
+    worker();
+  } else {
+    std::vector<std::thread> workers;
+    for (int k = 0; k < threads; ++k) workers.emplace_back(worker);
+    for (auto& w : workers) w.join();
+  }
+  if (!error.empty()) throw std::runtime_error(error);
+}
+
+void ForEachPart(const int rows, const int jobs,
+                 const std::function<void(const int, const int)>& work) {
+  if (jobs < 1)
+    throw std::invalid_argument("ForEachPart(...): jobs must be positive");
+  int parts = std::min(rows, jobs);
+  ForEach(parts, parts, [&](const int k) {
+    work(static_cast<int>(1LL * rows * k / parts),
+         static_cast<int>(1LL * rows * (k + 1) / parts));
+  });
+}
+
+}  // namespace parallel
@@ -0,0 +1,22 @@
+#pragma once
+#ifndef PARALLEL_HPP
+#define PARALLEL_HPP
+
+#include <functional>
+
+namespace parallel {
+
+// Runs work(n) for every n in [0, count) on min(count, jobs) threads, each
+// taking the next n as it finishes; with one thread the work runs on the
+// caller's. The first error stops the items that haven't started and is
+// rethrown as std::runtime_error with its message.
+void ForEach(const int count, const int jobs,
+             const std::function<void(const int)>& work);
+
+// Runs work(first, last) over min(rows, jobs) contiguous parts of
+// [0, rows) of nearly equal size, in the same way.
+void ForEachPart(const int rows, const int jobs,
+                 const std::function<void(const int, const int)>& work);
+
+}  // namespace parallel
+#endif  // PARALLEL_HPP
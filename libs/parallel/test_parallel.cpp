@@ -0,0 +1,51 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <doctest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "parallel.hpp"
+
+TEST_CASE("every item once") {
+  for (int jobs : {1, 3, 16}) {
+    CAPTURE(jobs);
+    std::vector<std::atomic<int>> done(10);
+    parallel::ForEach(10, jobs, [&](const int n) { ++done[n]; });
+    for (const auto& d : done) CHECK_EQ(d.load(), 1);
+  }
+  parallel::ForEach(0, 4, [](const int) { FAIL("no items"); });
+  CHECK_THROWS_WITH_AS(parallel::ForEach(3, 0, [](const int) {}),
+                       "ForEach(...): jobs must be positive",
+                       const std::invalid_argument&);
+}
+
+TEST_CASE("parts cover the rows") {
+  for (int rows : {1, 7, 100})
+    for (int jobs : {1, 3, 200}) {
+      CAPTURE(rows);
+      CAPTURE(jobs);
+      std::vector<std::atomic<int>> done(rows);
+      std::atomic<int> parts{0};
+      parallel::ForEachPart(rows, jobs, [&](const int first, const int last) {
+        CHECK_LT(first, last);
+        ++parts;
+        for (int i = first; i < last; ++i) ++done[i];
+      });
+      CHECK_EQ(parts.load(), std::min(rows, jobs));
+      for (const auto& d : done) CHECK_EQ(d.load(), 1);
+    }
+}
+
+TEST_CASE("the first error stops the rest") {
+  std::atomic<int> started{0};
+  auto work = [&](const int n) {
+    ++started;
+    if (n == 2) throw std::out_of_range("item " + std::to_string(n));
+  };
+  CHECK_THROWS_WITH_AS(parallel::ForEach(1000, 1, work), "item 2",
+                       const std::runtime_error&);
+  CHECK_EQ(started.load(), 3);
+}
@@ -0,0 +1,81 @@
+#include <cstdint>
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+#include <planar.hpp>
+#include <stdexcept>
+#include <vector>
+
+namespace planar {
+
+// in doubles
+static const int kAlignment = 8;
+
+Image::Image(const cv::Size& size, const int channels)
+    : size(size), channels(channels) {
+  if (size.width <= 0 || size.height <= 0)
+    throw std::invalid_argument("Image::Image(...): incorrect size");
+  if (channels < 1 || channels > 4)
+    throw std::invalid_argument("Image::Image(...): incorrect channels");
+  int stride = (size.width + kAlignment - 1) / kAlignment * kAlignment;
+  // one spare alignment block to move the first row to a 64-byte boundary;
+  // the step stays a multiple of 64 bytes, so the other rows follow
+  cv::Mat storage(channels * size.height, stride + kAlignment, CV_64FC1);
+  uintptr_t address = reinterpret_cast<uintptr_t>(storage.data);
+  int offset = static_cast<int>(
+      (kAlignment * sizeof(double) - address % (kAlignment * sizeof(double))) %
+      (kAlignment * sizeof(double)) / sizeof(double));
+  planes = storage.colRange(offset, offset + stride);
+}
+
+Image::Image(const cv::Mat& image) : Image(image.size(), image.channels()) {
+  if (image.depth() != CV_64F && image.depth() != CV_8U)
+    throw std::invalid_argument("Image::Image(...): incorrect type");
+  if (image.depth() == CV_64F) {
+    for (int i = 0; i < size.height; ++i) {
+      const double* src = image.ptr<double>(i);
+      for (int c = 0; c < channels; ++c) {
+        double* dst = Row(c, i);
+        for (int j = 0; j < size.width; ++j) dst[j] = src[j * channels + c];
+      }
+    }
+    return;
+  }
+  double lut[256];
+  for (int v = 0; v < 256; ++v) lut[v] = v / 255.0;
+  for (int i = 0; i < size.height; ++i) {
+    const unsigned char* src = image.ptr<unsigned char>(i);
+    for (int c = 0; c < channels; ++c) {
+      double* dst = Row(c, i);
+      for (int j = 0; j < size.width; ++j) dst[j] = lut[src[j * channels + c]];
+    }
+  }
+}
+
+cv::Mat Image::Plane(const int channel) const {
+  if (channel < 0 || channel >= channels)
+    throw std::out_of_range("Image::Plane(...): no such channel");
+  return planes.rowRange(channel * size.height, (channel + 1) * size.height)
+      .colRange(0, size.width);
+}
+
+cv::Mat Image::ToMat() const {
+  if (Empty()) return cv::Mat();
+  std::vector<cv::Mat> views;
+  for (int c = 0; c < channels; ++c) views.push_back(Plane(c));
+  cv::Mat result;
+  cv::merge(views, result);
+  return result;
+}
+
+Image Resize(const Image& image, const cv::Size& size,
+             const int interpolation) {
+  Image result(size, image.Channels());
+  for (int c = 0; c < image.Channels(); ++c) {
+    // the view has the right size and type, so cv::resize writes into it
+    cv::Mat plane = result.Plane(c);
+    cv::resize(image.Plane(c), plane, size, 0, 0, interpolation);
+  }
+  return result;
+}
+
+}  // namespace planar
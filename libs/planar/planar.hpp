@@ -0,0 +1,51 @@
+#pragma once
+#ifndef PLANAR_HPP
+#define PLANAR_HPP
+
+#include <opencv2/core/mat.hpp>
+
+namespace planar {
+
+// Structure-of-arrays double image: one plane per channel, every row starts
+// on a 64-byte boundary and is padded to a multiple of 8 doubles, so row
+// kernels get contiguous aligned loads and no cv::split/cv::merge is needed.
+// Copies share the data, as cv::Mat does.
+class Image {
+ public:
+  Image() = default;
+  Image(const cv::Size& size, const int channels);
+  // Copies an interleaved CV_64FC<n> image or a CV_8UC<n> one scaled by 1/255.
+  explicit Image(const cv::Mat& image);
+  ~Image() = default;
+
+  // Interleaved CV_64FC<n> copy for the API boundary.
+  cv::Mat ToMat() const;
+  cv::Size Size() const { return size; }
+  int Rows() const { return size.height; }
+  int Cols() const { return size.width; }
+  int Channels() const { return channels; }
+  bool Empty() const { return channels == 0; }
+  // distance between rows in doubles
+  size_t Stride() const { return planes.step1(); }
+  double* Row(const int channel, const int row) {
+    return planes.ptr<double>(channel * size.height + row);
+  }
+  const double* Row(const int channel, const int row) const {
+    return planes.ptr<double>(channel * size.height + row);
+  }
+  // CV_64FC1 rows x cols view of a channel without copying, e.g. for OpenCV
+  // functions writing into a preallocated result.
+  cv::Mat Plane(const int channel) const;
+
+ private:
+  cv::Size size;
+  int channels = 0;
+  // channels * rows aligned rows
+  cv::Mat planes;
+};
+
+// Resizes every plane with cv::resize.
+Image Resize(const Image& image, const cv::Size& size, const int interpolation);
+
+}  // namespace planar
+#endif  // PLANAR_HPP
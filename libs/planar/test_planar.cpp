@@ -0,0 +1,53 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <doctest.h>
+
+#include <cstdint>
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+#include <stdexcept>
+
+#include "planar.hpp"
+
+TEST_CASE("layout") {
+  planar::Image image(cv::Size(13, 5), 3);
+  CHECK_EQ(image.Stride() % 8, 0);
+  CHECK(image.Stride() >= 13);
+  for (int c = 0; c < 3; ++c)
+    for (int i = 0; i < 5; ++i)
+      CHECK_EQ(reinterpret_cast<uintptr_t>(image.Row(c, i)) % 64, 0);
+  CHECK_EQ(image.Plane(1).size(), cv::Size(13, 5));
+  CHECK_EQ(image.Plane(1).type(), CV_64FC1);
+  CHECK_THROWS_AS(image.Plane(3), const std::out_of_range&);
+  CHECK_THROWS_WITH_AS(planar::Image(cv::Size(0, 5), 3),
+                       "Image::Image(...): incorrect size",
+                       const std::invalid_argument&);
+}
+
+TEST_CASE("conversion") {
+  cv::Mat packed(7, 11, CV_8UC3);
+  cv::randu(packed, cv::Scalar::all(0), cv::Scalar::all(256));
+  cv::Mat image;
+  packed.convertTo(image, CV_64FC3, 1.0 / 255.0);
+  planar::Image from_double(image);
+  planar::Image from_packed(packed);
+  CHECK(cv::norm(from_double.ToMat(), image, cv::NORM_INF) == 0);
+  CHECK(cv::norm(from_packed.ToMat(), image, cv::NORM_INF) < 1e-15);
+  CHECK_EQ(from_double.Row(2, 3)[4], image.at<cv::Vec3d>(3, 4)[2]);
+  CHECK_THROWS_WITH_AS(planar::Image(cv::Mat(3, 3, CV_32FC3)),
+                       "Image::Image(...): incorrect type",
+                       const std::invalid_argument&);
+
+  planar::Image shared = from_double;
+  shared.Row(0, 0)[0] = 2.0;
+  CHECK_EQ(from_double.Row(0, 0)[0], 2.0);
+}
+
+TEST_CASE("Resize") {
+  cv::Mat image(16, 24, CV_64FC3);
+  cv::randu(image, cv::Scalar::all(0), cv::Scalar::all(1));
+  cv::Mat ideal;
+  cv::resize(image, ideal, cv::Size(6, 4), 0, 0, cv::INTER_AREA);
+  planar::Image small =
+      planar::Resize(planar::Image(image), cv::Size(6, 4), cv::INTER_AREA);
+  CHECK(cv::norm(small.ToMat(), ideal, cv::NORM_INF) < 1e-12);
+}
@@ -0,0 +1,115 @@
+#include <sat.hpp>
+#include <algorithm>
+#include <opencv2/core.hpp>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace sat {
+
+Table::Table(const cv::Mat& image, const int border)
+    : size(image.size()), channels(image.channels()), border(border) {
+  if (image.empty())
+    throw std::invalid_argument("Table::Table(...): image is empty");
+  if (channels > 4)
+    throw std::invalid_argument("Table::Table(...): incorrect channels");
+  if (border < 0)
+    throw std::invalid_argument("Table::Table(...): border is negative");
+  cv::Size padded(size.width + 2 * border, size.height + 2 * border);
+  int stripes = (padded.height + stripe_rows - 1) / stripe_rows;
+  sums.create(stripes * (stripe_rows + 1), (padded.width + 1) * channels,
+              CV_64FC1);
+  std::vector<int> columns(padded.width);
+  for (int x = 0; x < padded.width; ++x)
+    columns[x] = cv::borderInterpolate(x - border, size.width,
+                                       cv::BORDER_REFLECT_101);
+  cv::parallel_for_(cv::Range(0, stripes), [&](const cv::Range& range) {
+    cv::Mat line;
+    std::vector<double> running(channels);
+    for (int k = range.start; k < range.end; ++k) {
+      double* first = sums.ptr<double>(k * (stripe_rows + 1));
+      std::fill(first, first + sums.cols, 0.0);
+      int rows = std::min(stripe_rows, padded.height - k * stripe_rows);
+      for (int l = 0; l < rows; ++l) {
+        int i = cv::borderInterpolate(k * stripe_rows + l - border,
+                                      size.height, cv::BORDER_REFLECT_101);
+        image.row(i).convertTo(line, CV_64F);
+        const double* values = line.ptr<double>();
+        const double* above = Entry(k, l);
+        double* current = sums.ptr<double>(k * (stripe_rows + 1) + l + 1);
+        std::fill(running.begin(), running.end(), 0.0);
+        std::fill(current, current + channels, 0.0);
+        for (int x = 0; x < padded.width; ++x) {
+          const double* value = values + columns[x] * channels;
+          int at = (x + 1) * channels;
+          for (int c = 0; c < channels; ++c) {
+            running[c] += value[c];
+            current[at + c] = above[at + c] + running[c];
+          }
+        }
+      }
+    }
+  });
+}
+
+void Table::Add(const int top, const int bottom, const int left,
+                const int right, double* result) const {
+  int l = left * channels;
+  int r = right * channels;
+  for (int k = top / stripe_rows; k * stripe_rows < bottom; ++k) {
+    const double* upper = Entry(k, std::max(top - k * stripe_rows, 0));
+    const double* lower =
+        Entry(k, std::min(bottom - k * stripe_rows, stripe_rows));
+    for (int c = 0; c < channels; ++c)
+      result[c] += lower[r + c] - lower[l + c] - upper[r + c] + upper[l + c];
+  }
+}
+
+void Table::CheckWindow(const cv::Rect& window,
+                        const std::string& func) const {
+  if (Empty()) throw std::logic_error(func + "(...): table is empty");
+  if (window.width < 0 || window.height < 0 || window.x < -border ||
+      window.y < -border || window.x + window.width > size.width + border ||
+      window.y + window.height > size.height + border)
+    throw std::out_of_range(func + "(...): window is outside the table");
+}
+
+cv::Scalar Table::Sum(const cv::Rect& window) const {
+  CheckWindow(window, "Table::Sum");
+  cv::Scalar result;
+  Add(window.y + border, window.y + window.height + border,
+      window.x + border, window.x + window.width + border, result.val);
+  return result;
+}
+
+cv::Mat Table::BoxMean(const int ksize, const cv::Rect& roi) const {
+  if (ksize < 1)
+    throw std::invalid_argument("Table::BoxMean(...): ksize must be positive");
+  int before = ksize / 2;
+  CheckWindow(cv::Rect(roi.x - before, roi.y - before,
+                       roi.width + ksize - 1, roi.height + ksize - 1),
+              "Table::BoxMean");
+  cv::Mat result(roi.size(), CV_MAKETYPE(CV_64F, channels));
+  double scale = 1.0 / (static_cast<double>(ksize) * ksize);
+  cv::parallel_for_(cv::Range(0, roi.height), [&](const cv::Range& range) {
+    double sum[4];
+    for (int i = range.start; i < range.end; ++i) {
+      int top = roi.y + i - before + border;
+      double* dst = result.ptr<double>(i);
+      for (int j = 0; j < roi.width; ++j) {
+        int left = roi.x + j - before + border;
+        std::fill(sum, sum + channels, 0.0);
+        Add(top, top + ksize, left, left + ksize, sum);
+        for (int c = 0; c < channels; ++c)
+          dst[j * channels + c] = sum[c] * scale;
+      }
+    }
+  });
+  return result;
+}
+
+cv::Mat Table::BoxMean(const int ksize) const {
+  return BoxMean(ksize, cv::Rect(cv::Point(0, 0), size));
+}
+
+}  // namespace sat
@@ -0,0 +1,60 @@
+#pragma once
+#ifndef SAT_HPP
+#define SAT_HPP
+
+#include <opencv2/core/mat.hpp>
+#include <string>
+
+namespace sat {
+
+// Summed-area table of an image with 1 to 4 channels of any depth, extended
+// by border pixels on every side with the reflect-101 rule of cv::boxFilter,
+// so a window sum costs O(1) wherever the window lies. The table is built
+// once in parallel and then shared by any number of queries.
+//
+// The sums are doubles restarted every stripe_rows rows: an entry never
+// exceeds stripe_rows * width values, so the cancellation error of a window
+// sum doesn't grow with the image height, and the stripes are built
+// independently. A window crossing stripes is summed piece by piece.
+class Table {
+ public:
+  static constexpr int stripe_rows = 256;
+
+  Table() = default;
+  explicit Table(const cv::Mat& image, const int border = 0);
+  ~Table() = default;
+
+  cv::Size Size() const { return size; }
+  int Channels() const { return channels; }
+  int Border() const { return border; }
+  bool Empty() const { return channels == 0; }
+  // Sum of a window in image coordinates, it may cover border pixels, i.e.
+  // start at -Border() and end at Size() + Border().
+  cv::Scalar Sum(const cv::Rect& window) const;
+  // Means of ksize x ksize windows anchored as in cv::boxFilter at every
+  // pixel of roi, CV_64FC<Channels()> of roi.size(). The windows must stay
+  // within the border.
+  cv::Mat BoxMean(const int ksize, const cv::Rect& roi) const;
+  // The same for every pixel of the image; needs ksize / 2 <= Border().
+  cv::Mat BoxMean(const int ksize) const;
+
+ private:
+  // table row l of stripe k: sums over padded rows [k * stripe_rows,
+  // k * stripe_rows + l) and padded columns [0, x) at x * channels
+  const double* Entry(const int stripe, const int row) const {
+    return sums.ptr<double>(stripe * (stripe_rows + 1) + row);
+  }
+  // adds the sums over padded rows [top, bottom) and padded columns
+  // [left, right) to result[0 .. channels)
+  void Add(const int top, const int bottom, const int left, const int right,
+           double* result) const;
+  void CheckWindow(const cv::Rect& window, const std::string& func) const;
+
+  cv::Size size;
+  int channels = 0;
+  int border = 0;
+  cv::Mat sums;
+};
+
+}  // namespace sat
+#endif  // SAT_HPP
@@ -0,0 +1,61 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <doctest.h>
+
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+#include <stdexcept>
+
+#include "sat.hpp"
+
+TEST_CASE("window sums") {
+  // taller than a stripe, so windows cross stripe boundaries
+  cv::Mat image(300, 37, CV_8UC3);
+  cv::randu(image, cv::Scalar::all(0), cv::Scalar::all(256));
+  sat::Table table(image);
+  CHECK_EQ(table.Size(), image.size());
+  CHECK_EQ(table.Channels(), 3);
+  for (const cv::Rect& window :
+       {cv::Rect(0, 0, 37, 300), cv::Rect(3, 250, 11, 10),
+        cv::Rect(5, 0, 1, 256), cv::Rect(0, 255, 37, 2),
+        cv::Rect(36, 299, 1, 1)}) {
+    CAPTURE(window);
+    cv::Scalar sum = table.Sum(window);
+    cv::Scalar ideal = cv::sum(image(window));
+    // sums of integers are exact in doubles
+    for (int c = 0; c < 4; ++c) CHECK_EQ(sum[c], ideal[c]);
+  }
+  CHECK_THROWS_WITH_AS(table.Sum(cv::Rect(-1, 0, 2, 2)),
+                       "Table::Sum(...): window is outside the table",
+                       const std::out_of_range&);
+  CHECK_THROWS_WITH_AS(sat::Table(cv::Mat(3, 3, CV_8UC(5))),
+                       "Table::Table(...): incorrect channels",
+                       const std::invalid_argument&);
+}
+
+TEST_CASE("box mean matches OpenCV") {
+  for (const cv::Size& size : {cv::Size(31, 23), cv::Size(19, 270)}) {
+    for (int type : {CV_64FC1, CV_64FC3}) {
+      cv::Mat image(size, type);
+      cv::randu(image, cv::Scalar::all(0), cv::Scalar::all(1));
+      for (int ksize : {1, 2, 5, 9, 51}) {
+        CAPTURE(size);
+        CAPTURE(ksize);
+        cv::Mat ideal;
+        cv::boxFilter(image, ideal, CV_64F, cv::Size(ksize, ksize));
+        sat::Table table(image, ksize / 2);
+        cv::Mat mean = table.BoxMean(ksize);
+        CHECK_EQ(mean.type(), type);
+        CHECK(cv::norm(mean, ideal, cv::NORM_INF) < 1e-12);
+        cv::Rect roi(1, 2, size.width - 3, size.height - 5);
+        CHECK(cv::norm(table.BoxMean(ksize, roi), mean(roi), cv::NORM_INF) ==
+              0);
+      }
+    }
+  }
+  cv::Mat image(10, 10, CV_64FC1, cv::Scalar(1));
+  CHECK_THROWS_AS(sat::Table(image, 1).BoxMean(5), const std::out_of_range&);
+  // windows inside the image need no border
+  cv::Mat inner = sat::Table(image).BoxMean(5, cv::Rect(2, 2, 6, 6));
+  CHECK(cv::norm(inner, cv::Mat(6, 6, CV_64FC1, cv::Scalar(1)),
+                 cv::NORM_INF) < 1e-15);
+}
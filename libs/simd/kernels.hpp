@@ -0,0 +1,41 @@
+#pragma once
+#ifndef SIMD_KERNELS_HPP
+#define SIMD_KERNELS_HPP
+
+#include <cstddef>
+
+namespace simd {
+
+struct Kernels {
+  void (*channel_min)(const double*, double*, size_t);
+  void (*min)(const double*, const double*, double*, size_t);
+  void (*accumulate)(double*, const double*, const double*, size_t);
+  void (*recover)(const double*, const double*, double*, size_t,
+                  const double*, double);
+  void (*augment)(const double*, const double*, double*, size_t,
+                  const double*);
+  void (*intensity)(const double*, double*, size_t);
+  void (*min_quotient)(const double*, double, double*, size_t);
+  void (*sum3)(const double*, const double*, const double*, double*, size_t);
+  void (*recover_plane)(const double*, const double*, double*, size_t, double,
+                        double);
+  void (*augment_plane)(const double*, const double*, double*, size_t,
+                        double);
+};
+
+// one table per kernels_<isa>.cpp
+namespace generic {
+Kernels Get();
+}
+namespace sse42 {
+Kernels Get();
+}
+namespace avx2 {
+Kernels Get();
+}
+namespace avx512 {
+Kernels Get();
+}
+
+}  // namespace simd
+#endif  // SIMD_KERNELS_HPP
@@ -0,0 +1,104 @@
+// Kernel bodies, compiled once per instruction set by kernels_<isa>.cpp with
+// SIMD_KERNELS naming the namespace. The loops are plain C++ left to the
+// vectorizer. Nothing with inline functions (e.g. std::min) may be used here:
+// the linker could pick an AVX copy of it for code running on any CPU.
+// Outputs may alias inputs, e.g. min = Min(min, row) in place.
+
+#include <kernels.hpp>
+
+namespace simd {
+namespace SIMD_KERNELS {
+
+static void ChannelMin(const double* bgr, double* min,
+                       const size_t n) {
+  for (size_t j = 0; j < n; ++j) {
+    double b = bgr[3 * j];
+    double g = bgr[3 * j + 1];
+    double r = bgr[3 * j + 2];
+    double bg = g < b ? g : b;
+    min[j] = r < bg ? r : bg;
+  }
+}
+
+static void Min(const double* lhs, const double* rhs,
+                double* min, const size_t n) {
+  for (size_t j = 0; j < n; ++j) min[j] = rhs[j] < lhs[j] ? rhs[j] : lhs[j];
+}
+
+static void Accumulate(double* sum, const double* add,
+                       const double* sub, const size_t n) {
+  for (size_t j = 0; j < n; ++j) sum[j] += add[j] - sub[j];
+}
+
+static void Recover(const double* bgr,
+                    const double* transmission,
+                    double* result, const size_t n,
+                    const double* light, const double t0) {
+  double l0 = light[0];
+  double l1 = light[1];
+  double l2 = light[2];
+  for (size_t j = 0; j < n; ++j) {
+    double t = transmission[j] < t0 ? t0 : transmission[j];
+    double inverse = 1.0 / t;
+    result[3 * j] = (bgr[3 * j] - l0) * inverse + l0;
+    result[3 * j + 1] = (bgr[3 * j + 1] - l1) * inverse + l1;
+    result[3 * j + 2] = (bgr[3 * j + 2] - l2) * inverse + l2;
+  }
+}
+
+static void Augment(const double* bgr,
+                    const double* transmission,
+                    double* result, const size_t n,
+                    const double* light) {
+  double l0 = light[0];
+  double l1 = light[1];
+  double l2 = light[2];
+  for (size_t j = 0; j < n; ++j) {
+    double t = transmission[j];
+    result[3 * j] = t * bgr[3 * j] + (1.0 - t) * l0;
+    result[3 * j + 1] = t * bgr[3 * j + 1] + (1.0 - t) * l1;
+    result[3 * j + 2] = t * bgr[3 * j + 2] + (1.0 - t) * l2;
+  }
+}
+
+static void Intensity(const double* bgr,
+                      double* intensity, const size_t n) {
+  for (size_t j = 0; j < n; ++j)
+    intensity[j] = bgr[3 * j] + bgr[3 * j + 1] + bgr[3 * j + 2];
+}
+
+static void MinQuotient(const double* plane, const double divisor,
+                        double* min, const size_t n) {
+  for (size_t j = 0; j < n; ++j) {
+    double quotient = plane[j] / divisor;
+    min[j] = quotient < min[j] ? quotient : min[j];
+  }
+}
+
+static void Sum3(const double* b, const double* g, const double* r,
+                 double* sum, const size_t n) {
+  for (size_t j = 0; j < n; ++j) sum[j] = b[j] + g[j] + r[j];
+}
+
+static void RecoverPlane(const double* plane, const double* transmission,
+                         double* result, const size_t n, const double light,
+                         const double t0) {
+  for (size_t j = 0; j < n; ++j) {
+    double t = transmission[j] < t0 ? t0 : transmission[j];
+    result[j] = (plane[j] - light) * (1.0 / t) + light;
+  }
+}
+
+static void AugmentPlane(const double* plane, const double* transmission,
+                         double* result, const size_t n, const double light) {
+  for (size_t j = 0; j < n; ++j)
+    result[j] = transmission[j] * plane[j] + (1.0 - transmission[j]) * light;
+}
+
+Kernels Get() {
+  return {ChannelMin, Min,         Accumulate, Recover,      Augment,
+          Intensity,  MinQuotient, Sum3,       RecoverPlane, AugmentPlane};
+}
+
+}  // namespace SIMD_KERNELS
+}  // namespace simd
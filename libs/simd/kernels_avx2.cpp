@@ -0,0 +1,2 @@
+#define SIMD_KERNELS avx2
+#include <kernels.inl>
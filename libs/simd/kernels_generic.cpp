@@ -0,0 +1,2 @@
+#define SIMD_KERNELS generic
+#include <kernels.inl>
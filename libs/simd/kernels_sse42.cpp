@@ -0,0 +1,2 @@
+#define SIMD_KERNELS sse42
+#include <kernels.inl>
@@ -0,0 +1,159 @@
+#include <atomic>
+#include <kernels.hpp>
+#include <simd.hpp>
+#include <stdexcept>
+
+#if defined(SIMD_X86) && defined(_MSC_VER)
+#include <immintrin.h>
+#include <intrin.h>
+#endif
+
+namespace simd {
+
+static Isa Cpuid() {
+#if defined(SIMD_X86) && (defined(__GNUC__) || defined(__clang__))
+  // the checks include OS support of the wide registers
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512dq") &&
+      __builtin_cpu_supports("avx512bw") && __builtin_cpu_supports("avx512vl"))
+    return AVX512;
+  if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+    return AVX2;
+  if (__builtin_cpu_supports("sse4.2")) return SSE42;
+  return GENERIC;
+#elif defined(SIMD_X86) && defined(_MSC_VER)
+  int info[4];
+  __cpuid(info, 0);
+  int max_leaf = info[0];
+  __cpuid(info, 1);
+  bool sse42 = (info[2] >> 20) & 1;
+  bool fma = (info[2] >> 12) & 1;
+  bool osxsave = (info[2] >> 27) & 1;
+  unsigned long long xcr0 = osxsave ? _xgetbv(0) : 0;
+  bool ymm = (xcr0 & 0x6) == 0x6;
+  bool zmm = (xcr0 & 0xe6) == 0xe6;
+  if (max_leaf >= 7) {
+    __cpuidex(info, 7, 0);
+    bool avx512 = ((info[1] >> 16) & 1) && ((info[1] >> 17) & 1) &&
+                  ((info[1] >> 30) & 1) && ((info[1] >> 31) & 1);
+    if (avx512 && zmm) return AVX512;
+    if (((info[1] >> 5) & 1) && fma && ymm) return AVX2;
+  }
+  return sse42 ? SSE42 : GENERIC;
+#else
+  return GENERIC;
+#endif
+}
+
+Isa DetectIsa() {
+  static const Isa isa = Cpuid();
+  return isa;
+}
+
+static std::atomic<int> active_isa{-1};
+
+Isa ActiveIsa() {
+  int isa = active_isa.load(std::memory_order_relaxed);
+  return isa < 0 ? DetectIsa() : static_cast<Isa>(isa);
+}
+
+void SetIsa(const Isa isa) {
+  if (isa < GENERIC || isa > AVX512)
+    throw std::invalid_argument("SetIsa(...): unknown instruction set");
+  if (isa > DetectIsa())
+    throw std::invalid_argument("SetIsa(...): " + IsaName(isa) +
+                                " isn't supported by the CPU");
+  active_isa = isa;
+}
+
+Isa ParseIsa(const std::string& name) {
+  if (name == "generic") return GENERIC;
+  if (name == "sse4.2") return SSE42;
+  if (name == "avx2") return AVX2;
+  if (name == "avx512") return AVX512;
+  throw std::invalid_argument("ParseIsa(...): unknown instruction set " +
+                              name);
+}
+
+std::string IsaName(const Isa isa) {
+  switch (isa) {
+    case SSE42:
+      return "sse4.2";
+    case AVX2:
+      return "avx2";
+    case AVX512:
+      return "avx512";
+    default:
+      return "generic";
+  }
+}
+
+static const Kernels& Active() {
+  static const Kernels generic_kernels = generic::Get();
+#ifdef SIMD_X86
+  static const Kernels sse42_kernels = sse42::Get();
+  static const Kernels avx2_kernels = avx2::Get();
+  static const Kernels avx512_kernels = avx512::Get();
+  switch (ActiveIsa()) {
+    case SSE42:
+      return sse42_kernels;
+    case AVX2:
+      return avx2_kernels;
+    case AVX512:
+      return avx512_kernels;
+    default:
+      break;
+  }
+#endif
+  return generic_kernels;
+}
+
+void ChannelMin(const double* bgr, double* min, const size_t n) {
+  Active().channel_min(bgr, min, n);
+}
+
+void Min(const double* lhs, const double* rhs, double* min, const size_t n) {
+  Active().min(lhs, rhs, min, n);
+}
+
+void Accumulate(double* sum, const double* add, const double* sub,
+                const size_t n) {
+  Active().accumulate(sum, add, sub, n);
+}
+
+void Recover(const double* bgr, const double* transmission, double* result,
+             const size_t n, const double light[3], const double t0) {
+  Active().recover(bgr, transmission, result, n, light, t0);
+}
+
+void Augment(const double* bgr, const double* transmission, double* result,
+             const size_t n, const double light[3]) {
+  Active().augment(bgr, transmission, result, n, light);
+}
+
+void Intensity(const double* bgr, double* intensity, const size_t n) {
+  Active().intensity(bgr, intensity, n);
+}
+
+void MinQuotient(const double* plane, const double divisor, double* min,
+                 const size_t n) {
+  Active().min_quotient(plane, divisor, min, n);
+}
+
+void Sum3(const double* b, const double* g, const double* r, double* sum,
+          const size_t n) {
+  Active().sum3(b, g, r, sum, n);
+}
+
+void RecoverPlane(const double* plane, const double* transmission,
+                  double* result, const size_t n, const double light,
+                  const double t0) {
+  Active().recover_plane(plane, transmission, result, n, light, t0);
+}
+
+void AugmentPlane(const double* plane, const double* transmission,
+                  double* result, const size_t n, const double light) {
+  Active().augment_plane(plane, transmission, result, n, light);
+}
+
+}  // namespace simd
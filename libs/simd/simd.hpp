@@ -0,0 +1,66 @@
+#pragma once
+#ifndef SIMD_HPP
+#define SIMD_HPP
+
+#include <cstddef>
+#include <string>
+
+namespace simd {
+
+// Instruction sets the kernels are compiled for, from the oldest one.
+enum Isa { GENERIC, SSE42, AVX2, AVX512 };
+
+// The newest instruction set supported by both the CPU (CPUID) and the build.
+Isa DetectIsa();
+
+// The instruction set the kernels dispatch to, DetectIsa() unless overridden.
+Isa ActiveIsa();
+
+void SetIsa(const Isa isa);
+
+Isa ParseIsa(const std::string& name);
+
+std::string IsaName(const Isa isa);
+
+// Row kernels; bgr points to n interleaved 3-channel pixels. All variants
+// give bit-identical results, so the instruction set only changes speed.
+
+// min over the three colors of every pixel
+void ChannelMin(const double* bgr, double* min, const size_t n);
+
+void Min(const double* lhs, const double* rhs, double* min, const size_t n);
+
+// sum += add - sub, a step of running box sums
+void Accumulate(double* sum, const double* add, const double* sub,
+                const size_t n);
+
+// (bgr - light) / max(transmission, t0) + light
+void Recover(const double* bgr, const double* transmission, double* result,
+             const size_t n, const double light[3], const double t0);
+
+// transmission * bgr + (1 - transmission) * light
+void Augment(const double* bgr, const double* transmission, double* result,
+             const size_t n, const double light[3]);
+
+// sum of the three colors of every pixel
+void Intensity(const double* bgr, double* intensity, const size_t n);
+
+// Kernels over one plane of a planar image, results equal to the ones above.
+
+// min = min(min, plane / divisor)
+void MinQuotient(const double* plane, const double divisor, double* min,
+                 const size_t n);
+
+// sum = b + g + r
+void Sum3(const double* b, const double* g, const double* r, double* sum,
+          const size_t n);
+
+void RecoverPlane(const double* plane, const double* transmission,
+                  double* result, const size_t n, const double light,
+                  const double t0);
+
+void AugmentPlane(const double* plane, const double* transmission,
+                  double* result, const size_t n, const double light);
+
+}  // namespace simd
+#endif  // SIMD_HPP
@@ -0,0 +1,112 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <doctest.h>
+
+#include <algorithm>
+#include <limits>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include "simd.hpp"
+
+static std::vector<double> Random(const size_t n, const unsigned seed) {
+  std::mt19937 gen(seed);
+  std::uniform_real_distribution<> value(0.0, 1.0);
+  std::vector<double> result(n);
+  for (auto& v : result) v = value(gen);
+  return result;
+}
+
+TEST_CASE("Isa names") {
+  for (auto isa : {simd::GENERIC, simd::SSE42, simd::AVX2, simd::AVX512})
+    CHECK_EQ(simd::ParseIsa(simd::IsaName(isa)), isa);
+  CHECK_THROWS_WITH_AS(simd::ParseIsa("neon"),
+                       "ParseIsa(...): unknown instruction set neon",
+                       const std::invalid_argument&);
+  CHECK_EQ(simd::ActiveIsa(), simd::DetectIsa());
+  if (simd::DetectIsa() < simd::AVX512)
+    CHECK_THROWS_AS(simd::SetIsa(simd::AVX512), const std::invalid_argument&);
+}
+
+TEST_CASE("kernels") {
+  // odd sizes leave tails after the vector loops
+  const size_t n = 1037;
+  auto bgr = Random(3 * n, 1);
+  auto row = Random(n, 2);
+  auto other = Random(n, 3);
+  const double light[3] = {0.7, 0.8, 0.9};
+  std::vector<double> channel_min(n), min(n), sum(row), recovered(3 * n),
+      augmented(3 * n), intensity(n);
+  for (size_t j = 0; j < n; ++j) {
+    channel_min[j] = std::min({bgr[3 * j], bgr[3 * j + 1], bgr[3 * j + 2]});
+    min[j] = std::min(row[j], other[j]);
+    sum[j] += other[j] - row[j];
+    double inverse = 1.0 / std::max(row[j], 0.1);
+    for (int c = 0; c < 3; ++c) {
+      recovered[3 * j + c] = (bgr[3 * j + c] - light[c]) * inverse + light[c];
+      augmented[3 * j + c] =
+          row[j] * bgr[3 * j + c] + (1.0 - row[j]) * light[c];
+    }
+    intensity[j] = bgr[3 * j] + bgr[3 * j + 1] + bgr[3 * j + 2];
+  }
+  for (int isa = simd::GENERIC; isa <= simd::DetectIsa(); ++isa) {
+    CAPTURE(isa);
+    simd::SetIsa(static_cast<simd::Isa>(isa));
+    std::vector<double> out(3 * n);
+    simd::ChannelMin(bgr.data(), out.data(), n);
+    CHECK(std::equal(channel_min.begin(), channel_min.end(), out.begin()));
+    simd::Min(row.data(), other.data(), out.data(), n);
+    CHECK(std::equal(min.begin(), min.end(), out.begin()));
+    std::vector<double> in_place(row);
+    simd::Min(in_place.data(), other.data(), in_place.data(), n);
+    CHECK(in_place == min);
+    in_place = row;
+    simd::Accumulate(in_place.data(), other.data(), row.data(), n);
+    CHECK(in_place == sum);
+    simd::Recover(bgr.data(), row.data(), out.data(), n, light, 0.1);
+    CHECK(out == recovered);
+    simd::Augment(bgr.data(), row.data(), out.data(), n, light);
+    CHECK(out == augmented);
+    simd::Intensity(bgr.data(), out.data(), n);
+    CHECK(std::equal(intensity.begin(), intensity.end(), out.begin()));
+  }
+  simd::SetIsa(simd::DetectIsa());
+}
+
+TEST_CASE("plane kernels") {
+  const size_t n = 517;
+  auto bgr = Random(3 * n, 4);
+  auto row = Random(n, 5);
+  std::vector<double> planes[3];
+  for (int c = 0; c < 3; ++c)
+    for (size_t j = 0; j < n; ++j) planes[c].push_back(bgr[3 * j + c]);
+  const double light[3] = {0.7, 0.8, 0.9};
+  std::vector<double> recovered(3 * n), augmented(3 * n), intensity(n);
+  simd::Recover(bgr.data(), row.data(), recovered.data(), n, light, 0.1);
+  simd::Augment(bgr.data(), row.data(), augmented.data(), n, light);
+  simd::Intensity(bgr.data(), intensity.data(), n);
+  for (int isa = simd::GENERIC; isa <= simd::DetectIsa(); ++isa) {
+    CAPTURE(isa);
+    simd::SetIsa(static_cast<simd::Isa>(isa));
+    std::vector<double> min(n, std::numeric_limits<double>::infinity());
+    for (int c = 0; c < 3; ++c)
+      simd::MinQuotient(planes[c].data(), light[c], min.data(), n);
+    std::vector<double> sum(n), out(n);
+    simd::Sum3(planes[0].data(), planes[1].data(), planes[2].data(),
+               sum.data(), n);
+    CHECK(sum == intensity);
+    for (size_t j = 0; j < n; ++j)
+      CHECK_EQ(min[j], std::min({planes[0][j] / light[0],
+                                 planes[1][j] / light[1],
+                                 planes[2][j] / light[2]}));
+    for (int c = 0; c < 3; ++c) {
+      simd::RecoverPlane(planes[c].data(), row.data(), out.data(), n,
+                         light[c], 0.1);
+      for (size_t j = 0; j < n; ++j) CHECK_EQ(out[j], recovered[3 * j + c]);
+      simd::AugmentPlane(planes[c].data(), row.data(), out.data(), n,
+                         light[c]);
+      for (size_t j = 0; j < n; ++j) CHECK_EQ(out[j], augmented[3 * j + c]);
+    }
+  }
+  simd::SetIsa(simd::DetectIsa());
+}
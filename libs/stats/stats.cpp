@@ -0,0 +1,154 @@
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <iomanip>
+#include <map>
+#include <mutex>
+#include <opencv2/core.hpp>
+#include <sstream>
+#include <stats.hpp>
+
+namespace stats {
+
+namespace {
+
+struct Sample {
+  double ms;
+  size_t allocations;
+  size_t allocated_bytes;
+};
+
+std::atomic<bool> enabled{false};
+std::mutex samples_mutex;
+std::map<std::string, std::vector<Sample>> samples;
+
+// counters are per thread, so a timer sees only its own thread's allocations
+thread_local size_t thread_allocations = 0;
+thread_local size_t thread_allocated_bytes = 0;
+
+class CountingAllocator : public cv::MatAllocator {
+ public:
+  cv::UMatData* allocate(int dims, const int* sizes, int type, void* data,
+                         size_t* step, cv::AccessFlag flags,
+                         cv::UMatUsageFlags usage_flags) const override {
+    if (data == nullptr) {
+      size_t bytes = CV_ELEM_SIZE(type);
+      for (int i = 0; i < dims; ++i) bytes *= sizes[i];
+      ++thread_allocations;
+      thread_allocated_bytes += bytes;
+    }
+    return cv::Mat::getStdAllocator()->allocate(dims, sizes, type, data, step,
+                                                flags, usage_flags);
+  }
+  bool allocate(cv::UMatData* data, cv::AccessFlag access_flags,
+                cv::UMatUsageFlags usage_flags) const override {
+    return cv::Mat::getStdAllocator()->allocate(data, access_flags,
+                                                usage_flags);
+  }
+  void deallocate(cv::UMatData* data) const override {
+    cv::Mat::getStdAllocator()->deallocate(data);
+  }
+};
+
+CountingAllocator counting_allocator;
+
+double Percentile(const std::vector<double>& sorted, const double p) {
+  size_t rank = static_cast<size_t>(std::ceil(p / 100.0 * sorted.size()));
+  return sorted[std::max<size_t>(rank, 1) - 1];
+}
+
+}  // namespace
+
+void Enable(const bool enable) {
+  cv::Mat::setDefaultAllocator(enable ? &counting_allocator
+                                      : cv::Mat::getStdAllocator());
+  enabled.store(enable, std::memory_order_relaxed);
+}
+
+bool Enabled() { return enabled.load(std::memory_order_relaxed); }
+
+void Record(const std::string& stage, const double ms,
+            const size_t allocations, const size_t allocated_bytes) {
+  std::lock_guard<std::mutex> lock(samples_mutex);
+  samples[stage].push_back({ms, allocations, allocated_bytes});
+}
+
+void Reset() {
+  std::lock_guard<std::mutex> lock(samples_mutex);
+  samples.clear();
+}
+
+std::vector<StageSummary> Summary() {
+  std::lock_guard<std::mutex> lock(samples_mutex);
+  std::vector<StageSummary> result;
+  for (const auto& [stage, stage_samples] : samples) {
+    StageSummary summary;
+    summary.stage = stage;
+    summary.count = stage_samples.size();
+    std::vector<double> times;
+    for (const auto& sample : stage_samples) {
+      times.push_back(sample.ms);
+      summary.total_ms += sample.ms;
+      summary.allocations += sample.allocations;
+      summary.allocated_bytes += sample.allocated_bytes;
+    }
+    std::sort(times.begin(), times.end());
+    summary.p50_ms = Percentile(times, 50);
+    summary.p95_ms = Percentile(times, 95);
+    summary.p99_ms = Percentile(times, 99);
+    result.push_back(summary);
+  }
+  return result;
+}
+
+std::string ToJson() {
+  std::ostringstream json;
+  json << "{\n  \"stages\": [";
+  auto summary = Summary();
+  for (size_t i = 0; i < summary.size(); ++i) {
+    const auto& s = summary[i];
+    json << (i == 0 ? "\n" : ",\n") << "    {\"stage\": \"" << s.stage
+         << "\", \"count\": " << s.count << ", \"total_ms\": " << s.total_ms
+         << ", \"p50_ms\": " << s.p50_ms << ", \"p95_ms\": " << s.p95_ms
+         << ", \"p99_ms\": " << s.p99_ms
+         << ", \"allocations\": " << s.allocations
+         << ", \"allocated_bytes\": " << s.allocated_bytes << "}";
+  }
+  json << "\n  ]\n}\n";
+  return json.str();
+}
+
+void Print(std::ostream& stream) {
+  stream << std::left << std::setw(24) << "stage" << std::right
+         << std::setw(8) << "count" << std::setw(12) << "total, ms"
+         << std::setw(10) << "p50, ms" << std::setw(10) << "p95, ms"
+         << std::setw(10) << "p99, ms" << std::setw(10) << "allocs"
+         << std::setw(12) << "alloc, MB" << "\n";
+  stream << std::fixed << std::setprecision(2);
+  for (const auto& s : Summary()) {
+    stream << std::left << std::setw(24) << s.stage << std::right
+           << std::setw(8) << s.count << std::setw(12) << s.total_ms
+           << std::setw(10) << s.p50_ms << std::setw(10) << s.p95_ms
+           << std::setw(10) << s.p99_ms << std::setw(10) << s.allocations
+           << std::setw(12) << s.allocated_bytes / (1024.0 * 1024.0) << "\n";
+  }
+}
+
+ScopedTimer::ScopedTimer(const char* stage)
+    : stage(stage), active(Enabled()), span(stage) {
+  if (!active) return;
+  start_allocations = thread_allocations;
+  start_allocated_bytes = thread_allocated_bytes;
+  start = std::chrono::steady_clock::now();
+}
+
+ScopedTimer::~ScopedTimer() {
+  if (!active) return;
+  auto finish = std::chrono::steady_clock::now();
+  Record(stage,
+         std::chrono::duration<double, std::milli>(finish - start).count(),
+         thread_allocations - start_allocations,
+         thread_allocated_bytes - start_allocated_bytes);
+}
+
+}  // namespace stats
@@ -0,0 +1,63 @@
+#pragma once
+#ifndef STATS_HPP
+#define STATS_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <trace/trace.hpp>
+#include <vector>
+
+namespace stats {
+
+struct StageSummary {
+  std::string stage;
+  size_t count = 0;
+  double total_ms = 0;
+  double p50_ms = 0;
+  double p95_ms = 0;
+  double p99_ms = 0;
+  size_t allocations = 0;
+  size_t allocated_bytes = 0;
+};
+
+// While enabled, cv::Mat allocations go through a counting allocator and every
+// ScopedTimer records its duration; while disabled a timer is a single load.
+// Each timer is also a trace::Span, so stages show up in traces as well.
+void Enable(const bool enable);
+
+bool Enabled();
+
+void Record(const std::string& stage, const double ms,
+            const size_t allocations = 0, const size_t allocated_bytes = 0);
+
+void Reset();
+
+std::vector<StageSummary> Summary();
+
+std::string ToJson();
+
+void Print(std::ostream& stream);
+
+class ScopedTimer {
+ public:
+  ScopedTimer() = delete;
+  ScopedTimer(const ScopedTimer&) = delete;
+  ScopedTimer(ScopedTimer&&) = delete;
+  ScopedTimer& operator=(const ScopedTimer&) = delete;
+  ScopedTimer& operator=(ScopedTimer&&) = delete;
+  explicit ScopedTimer(const char* stage);
+  ~ScopedTimer();
+
+ private:
+  const char* stage;
+  bool active;
+  std::chrono::steady_clock::time_point start;
+  size_t start_allocations = 0;
+  size_t start_allocated_bytes = 0;
+  trace::Span span;
+};
+
+}  // namespace stats
+#endif  // STATS_HPP
@@ -0,0 +1,44 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <doctest.h>
+
+#include <opencv2/core.hpp>
+#include <stats.hpp>
+
+TEST_CASE("disabled") {
+  stats::Reset();
+  stats::Enable(false);
+  {
+    stats::ScopedTimer timer("disabled");
+    cv::Mat m(10, 10, CV_64FC3);
+  }
+  CHECK(stats::Summary().empty());
+}
+
+TEST_CASE("ScopedTimer") {
+  stats::Reset();
+  stats::Enable(true);
+  for (int i = 0; i < 3; ++i) {
+    stats::ScopedTimer timer("allocation");
+    cv::Mat m(10, 20, CV_64FC3);
+  }
+  stats::Enable(false);
+  auto summary = stats::Summary();
+  REQUIRE_EQ(summary.size(), 1);
+  CHECK_EQ(summary[0].stage, "allocation");
+  CHECK_EQ(summary[0].count, 3);
+  CHECK_EQ(summary[0].allocations, 3);
+  CHECK_EQ(summary[0].allocated_bytes, 3 * 10 * 20 * 3 * sizeof(double));
+}
+
+TEST_CASE("percentiles") {
+  stats::Reset();
+  for (int i = 1; i <= 100; ++i) stats::Record("stage", i);
+  auto summary = stats::Summary();
+  REQUIRE_EQ(summary.size(), 1);
+  CHECK_EQ(summary[0].count, 100);
+  CHECK_EQ(summary[0].p50_ms, 50);
+  CHECK_EQ(summary[0].p95_ms, 95);
+  CHECK_EQ(summary[0].p99_ms, 99);
+  CHECK_EQ(summary[0].total_ms, 5050);
+  CHECK_NE(stats::ToJson().find("\"p95_ms\": 95"), std::string::npos);
+}
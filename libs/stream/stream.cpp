@@ -0,0 +1,107 @@
+#include <dcp.hpp>
+#include <haze_model.hpp>
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+#include <stdexcept>
+#include <stream.hpp>
+
+namespace stream {
+
+cv::Mat WrapBuffer(const FrameBuffer& buffer, const cv::Size& frame_size,
+                   const PixelFormat format) {
+  if (buffer.data == nullptr)
+    throw std::invalid_argument("WrapBuffer(...): buffer is empty");
+  int channels = format == BGR8 ? 3 : 1;
+  size_t min_stride = static_cast<size_t>(frame_size.width) * channels;
+  size_t stride = buffer.stride == 0 ? min_stride : buffer.stride;
+  if (stride < min_stride)
+    throw std::invalid_argument("WrapBuffer(...): stride is too small");
+  return cv::Mat(frame_size, CV_8UC(channels), buffer.data, stride);
+}
+
+cv::Mat WrapChroma(const FrameBuffer& buffer, const cv::Size& frame_size) {
+  if (buffer.data == nullptr)
+    throw std::invalid_argument("WrapChroma(...): buffer is empty");
+  size_t luma_stride = buffer.stride == 0
+                           ? static_cast<size_t>(frame_size.width)
+                           : buffer.stride;
+  unsigned char* chroma = buffer.chroma != nullptr
+                              ? buffer.chroma
+                              : buffer.data + luma_stride * frame_size.height;
+  size_t stride = buffer.chroma_stride == 0 ? luma_stride : buffer.chroma_stride;
+  if (stride < static_cast<size_t>(frame_size.width))
+    throw std::invalid_argument("WrapChroma(...): stride is too small");
+  return cv::Mat(frame_size.height / 2, frame_size.width / 2, CV_8UC2, chroma,
+                 stride);
+}
+
+StreamDehazer::StreamDehazer(const cv::Size& frame_size,
+                             const PixelFormat format, const bool incremental)
+    : frame_size(frame_size),
+      format(format),
+      incremental(incremental),
+      dehazer(frame_size) {
+  if (format == NV12 &&
+      (frame_size.width % 2 != 0 || frame_size.height % 2 != 0))
+    throw std::invalid_argument(
+        "StreamDehazer::StreamDehazer(...): NV12 frame size must be even");
+  if (format == NV12) {
+    bgr.create(frame_size, CV_8UC3);
+    recovered_bgr.create(frame_size, CV_8UC3);
+    i420.create(frame_size.height * 3 / 2, frame_size.width, CV_8UC1);
+  }
+  if (incremental) {
+    frame.create(frame_size, CV_64FC3);
+    recovered.create(frame_size, CV_64FC3);
+  }
+}
+
+void StreamDehazer::Process(const FrameBuffer& result,
+                            const FrameBuffer& input) {
+  cv::Mat packed = Unpack(input);
+  // the header has the right size and type, so BGR8 results are written
+  // straight into the caller's memory
+  cv::Mat output =
+      format == BGR8 ? WrapBuffer(result, frame_size, BGR8) : recovered_bgr;
+  if (incremental) {
+    packed.convertTo(frame, CV_64FC3, 1.0 / 255.0);
+    dehazer.Process(recovered, frame);
+    recovered.convertTo(output, CV_8UC3, 255.);
+  } else {
+    cv::Mat light = dcp::EstimateAtmospericLight(packed, patch_size);
+    cv::Mat transmission =
+        dcp::EstimateTransmission(packed, light, patch_size);
+    haze::HazeModel model(
+        dcp::SoftMatting(transmission, packed, matting_patch_size, 0.01),
+        light);
+    model.RecoverImage(output, packed);
+  }
+  if (format == NV12) Pack(result);
+}
+
+cv::Mat StreamDehazer::Unpack(const FrameBuffer& input) {
+  if (format == BGR8) return WrapBuffer(input, frame_size, BGR8);
+  cv::cvtColorTwoPlane(WrapBuffer(input, frame_size, NV12),
+                       WrapChroma(input, frame_size), bgr,
+                       cv::COLOR_YUV2BGR_NV12);
+  return bgr;
+}
+
+void StreamDehazer::Pack(const FrameBuffer& result) {
+  cv::cvtColor(recovered_bgr, i420, cv::COLOR_BGR2YUV_I420);
+  i420.rowRange(0, frame_size.height)
+      .copyTo(WrapBuffer(result, frame_size, NV12));
+  cv::Mat chroma = WrapChroma(result, frame_size);
+  const int plane_size = chroma.rows * chroma.cols;
+  const unsigned char* u_plane = i420.ptr(frame_size.height);
+  const unsigned char* v_plane = u_plane + plane_size;
+  for (int i = 0; i < chroma.rows; ++i) {
+    cv::Vec2b* row = chroma.ptr<cv::Vec2b>(i);
+    for (int j = 0; j < chroma.cols; ++j) {
+      row[j][0] = u_plane[i * chroma.cols + j];
+      row[j][1] = v_plane[i * chroma.cols + j];
+    }
+  }
+}
+
+}  // namespace stream
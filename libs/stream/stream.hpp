@@ -0,0 +1,62 @@
+#pragma once
+#ifndef STREAM_HPP
+#define STREAM_HPP
+
+#include <cstddef>
+#include <opencv2/core/mat.hpp>
+#include <video.hpp>
+
+namespace stream {
+
+enum PixelFormat { BGR8, NV12 };
+
+// Caller-owned frame memory. For BGR8 only data is used; for NV12 data points
+// to the luma plane and chroma to the interleaved UV plane, which by default
+// follows the luma plane. Zero strides mean tightly packed rows.
+struct FrameBuffer {
+  unsigned char* data = nullptr;
+  size_t stride = 0;
+  unsigned char* chroma = nullptr;
+  size_t chroma_stride = 0;
+};
+
+cv::Mat WrapBuffer(const FrameBuffer& buffer, const cv::Size& frame_size,
+                   const PixelFormat format);
+
+cv::Mat WrapChroma(const FrameBuffer& buffer, const cv::Size& frame_size);
+
+class StreamDehazer {
+ public:
+  StreamDehazer() = delete;
+  StreamDehazer(const StreamDehazer&) = delete;
+  StreamDehazer(StreamDehazer&&) = delete;
+  StreamDehazer& operator=(const StreamDehazer&) = delete;
+  StreamDehazer& operator=(StreamDehazer&&) = delete;
+  StreamDehazer(const cv::Size& frame_size, const PixelFormat format,
+                const bool incremental = false);
+  void Process(const FrameBuffer& result, const FrameBuffer& input);
+  ~StreamDehazer() = default;
+
+ private:
+  cv::Mat Unpack(const FrameBuffer& input);
+  void Pack(const FrameBuffer& result);
+
+  // the defaults of video::IncrementalDehazer, so both modes agree on a frame
+  static constexpr int patch_size = 15;
+  static constexpr int matting_patch_size = 51;
+
+  const cv::Size frame_size;
+  const PixelFormat format;
+  const bool incremental;
+  video::IncrementalDehazer dehazer;
+  // NV12 frames are dehazed in BGR
+  cv::Mat bgr;
+  cv::Mat recovered_bgr;
+  cv::Mat i420;
+  // the incremental dehazer works on doubles
+  cv::Mat frame;
+  cv::Mat recovered;
+};
+
+}  // namespace stream
+#endif  // STREAM_HPP
@@ -0,0 +1,80 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <doctest.h>
+
+#include <dcp.hpp>
+#include <haze_model.hpp>
+#include <opencv2/core.hpp>
+#include <stream.hpp>
+#include <vector>
+
+TEST_CASE("WrapBuffer") {
+  std::vector<unsigned char> memory(4 * 40, 0);
+  stream::FrameBuffer buffer;
+  REQUIRE_THROWS_WITH_AS(
+      stream::WrapBuffer(buffer, cv::Size(10, 4), stream::BGR8),
+      "WrapBuffer(...): buffer is empty", const std::invalid_argument&);
+  buffer.data = memory.data();
+  buffer.stride = 20;
+  REQUIRE_THROWS_WITH_AS(
+      stream::WrapBuffer(buffer, cv::Size(10, 4), stream::BGR8),
+      "WrapBuffer(...): stride is too small", const std::invalid_argument&);
+  buffer.stride = 40;
+  cv::Mat wrapped = stream::WrapBuffer(buffer, cv::Size(10, 4), stream::BGR8);
+  CHECK_EQ(wrapped.data, memory.data());
+  CHECK_EQ(wrapped.step[0], size_t(40));
+  CHECK_EQ(wrapped.type(), CV_8UC3);
+}
+
+TEST_CASE("StreamDehazer BGR8") {
+  const cv::Size size(64, 48);
+  const size_t stride = size.width * 3 + 16;
+  std::vector<unsigned char> input_memory(stride * size.height);
+  std::vector<unsigned char> output_memory(stride * size.height, 0xAB);
+  stream::FrameBuffer input{input_memory.data(), stride};
+  stream::FrameBuffer output{output_memory.data(), stride};
+  cv::Mat input_image = stream::WrapBuffer(input, size, stream::BGR8);
+  cv::randu(input_image, cv::Scalar::all(40), cv::Scalar::all(220));
+
+  stream::StreamDehazer dehazer(size, stream::BGR8);
+  REQUIRE_NOTHROW(dehazer.Process(output, input));
+
+  // the 8-bit frame goes through the DCP functions as is
+  cv::Mat atmospheric_light = dcp::EstimateAtmospericLight(input_image, 15);
+  cv::Mat transmission =
+      dcp::EstimateTransmission(input_image, atmospheric_light, 15);
+  haze::HazeModel model(dcp::SoftMatting(transmission, input_image, 51, 0.01),
+                        atmospheric_light);
+  cv::Mat ideal(size, CV_8UC3);
+  model.RecoverImage(ideal, input_image);
+  CHECK_EQ(cv::norm(ideal, stream::WrapBuffer(output, size, stream::BGR8),
+                    cv::NORM_INF),
+           0.0);
+  for (int i = 0; i < size.height; ++i)
+    for (size_t j = size.width * 3; j < stride; ++j)
+      CHECK_EQ(output_memory[i * stride + j], 0xAB);
+}
+
+TEST_CASE("StreamDehazer NV12") {
+  REQUIRE_THROWS_WITH_AS(
+      [&]() { stream::StreamDehazer dehazer(cv::Size(63, 48), stream::NV12); }(),
+      "StreamDehazer::StreamDehazer(...): NV12 frame size must be even",
+      const std::invalid_argument&);
+  const cv::Size size(64, 48);
+  std::vector<unsigned char> input_memory(size.area() * 3 / 2, 128);
+  std::vector<unsigned char> output_memory(size.area() * 3 / 2, 0);
+  stream::FrameBuffer input{input_memory.data()};
+  stream::FrameBuffer output{output_memory.data()};
+  cv::Mat luma = stream::WrapBuffer(input, size, stream::NV12);
+  cv::randu(luma, cv::Scalar::all(60), cv::Scalar::all(200));
+
+  stream::StreamDehazer dehazer(size, stream::NV12, true);
+  REQUIRE_NOTHROW(dehazer.Process(output, input));
+  REQUIRE_NOTHROW(dehazer.Process(output, input));
+  // a gray input stays gray, so the chroma plane remains neutral
+  cv::Mat chroma = stream::WrapChroma(output, size);
+  double min_val = 0;
+  double max_val = 0;
+  cv::minMaxLoc(chroma.reshape(1), &min_val, &max_val);
+  CHECK_GE(min_val, 126);
+  CHECK_LE(max_val, 130);
+}
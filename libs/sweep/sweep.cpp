@@ -0,0 +1,166 @@
+#include <dcp/dcp.hpp>
+#include <haze_model/haze_model.hpp>
+#include <image_loader/image_loader.hpp>
+#include <opencv2/core.hpp>
+#include <parallel/parallel.hpp>
+#include <stats/stats.hpp>
+#include <stdexcept>
+#include <sweep.hpp>
+#include <trace/trace.hpp>
+
+namespace sweep {
+
+static void CheckGrid(const Grid& grid) {
+  if (grid.patch_sizes.empty() || grid.brightest_shares.empty() ||
+      grid.omegas.empty() || grid.matting_patch_sizes.empty() ||
+      grid.t0s.empty())
+    throw std::invalid_argument("Sweep(...): grid has an empty axis");
+}
+
+std::vector<exec::DehazeParameters> Configurations(const Grid& grid) {
+  CheckGrid(grid);
+  std::vector<exec::DehazeParameters> result;
+  for (int patch_size : grid.patch_sizes)
+    for (double brightest_share : grid.brightest_shares)
+      for (double omega : grid.omegas)
+        for (int matting_patch_size : grid.matting_patch_sizes)
+          for (double t0 : grid.t0s) {
+            exec::DehazeParameters parameters;
+            parameters.patch_size = patch_size;
+            parameters.brightest_share = brightest_share;
+            parameters.omega = omega;
+            parameters.matting_patch_size = matting_patch_size;
+            parameters.t0 = t0;
+            result.push_back(parameters);
+          }
+  return result;
+}
+
+void SweepImage(const cv::Mat& image, const Grid& grid,
+                const Consumer& consume) {
+  CheckGrid(grid);
+  size_t configuration = 0;
+  cv::Mat channel_min;
+  {
+    stats::ScopedTimer timer("channel_min");
+    channel_min = dcp::ChannelMin(image);
+  }
+  for (int patch_size : grid.patch_sizes) {
+    cv::Mat dark_channel;
+    {
+      stats::ScopedTimer timer("dark_channel");
+      dark_channel = dcp::MinFilter(channel_min, patch_size);
+    }
+    for (double brightest_share : grid.brightest_shares) {
+      cv::Mat atmospheric_light;
+      {
+        stats::ScopedTimer timer("atmospheric_light");
+        atmospheric_light =
+            dcp::EstimateAtmospericLight(image, dark_channel, brightest_share);
+      }
+      // the dark channel of the normalized image doesn't depend on omega,
+      // every transmission is 1 - omega * it, as in dcp::EstimateTransmission
+      cv::Mat normalized_dark_channel;
+      {
+        stats::ScopedTimer timer("transmission");
+        normalized_dark_channel = dcp::MinFilter(
+            dcp::NormalizedChannelMin(image, atmospheric_light), patch_size);
+      }
+      for (double omega : grid.omegas) {
+        cv::Mat transmission;
+        {
+          stats::ScopedTimer timer("transmission");
+          transmission = 1.0 - omega * normalized_dark_channel;
+        }
+        for (int matting_patch_size : grid.matting_patch_sizes) {
+          cv::Mat matting_tr;
+          {
+            stats::ScopedTimer timer("refinement");
+            matting_tr = dcp::SoftMatting(transmission, image,
+                                          matting_patch_size, 0.01);
+          }
+          cv::Mat result(image.size(), image.type());
+          for (double t0 : grid.t0s) {
+            {
+              stats::ScopedTimer timer("recovery");
+              haze::HazeModel model(matting_tr, atmospheric_light, t0);
+              model.RecoverImage(result, image);
+            }
+            consume(configuration++, result);
+          }
+        }
+      }
+    }
+  }
+}
+
+static std::vector<metrics::Scores> ScoreImage(
+    const std::filesystem::path& image_path,
+    const std::filesystem::path& ground_truth_path, const Grid& grid,
+    const size_t configurations) {
+  cv::Mat image;
+  cv::Mat ground_truth;
+  {
+    stats::ScopedTimer timer("decode");
+    image = load::LoadPackedImg(load::PathWrapper(image_path.u8string()));
+    ground_truth =
+        load::LoadPackedImg(load::PathWrapper(ground_truth_path.u8string()));
+  }
+  // 8-bit results are already saturated, scores are on the 8-bit scale
+  std::vector<metrics::Scores> scores(configurations);
+  SweepImage(image, grid, [&](const size_t c, const cv::Mat& result) {
+    stats::ScopedTimer timer("evaluation");
+    scores[c] = metrics::Compare(result, ground_truth, 255.0);
+  });
+  return scores;
+}
+
+std::vector<ConfigurationScores> Sweep(const std::string& input_path,
+                                       const std::string& ground_truth_path,
+                                       const Grid& grid, const int jobs) {
+  if (jobs < 1)
+    throw std::invalid_argument("Sweep(...): number of jobs must be positive");
+  auto configurations = Configurations(grid);
+  auto pairs = metrics::PairByName(input_path, ground_truth_path);
+  if (pairs.empty()) throw std::runtime_error("Sweep(...): no images");
+
+  // scores of every image are kept apart and summed in image order, so the
+  // means don't depend on the number of jobs
+  std::vector<std::vector<metrics::Scores>> image_scores(pairs.size());
+  try {
+    parallel::ForEach(static_cast<int>(pairs.size()), jobs, [&](const int i) {
+      std::string name = pairs[i].first.filename().u8string();
+      trace::SetDetail(name);
+      try {
+        image_scores[i] = ScoreImage(pairs[i].first, pairs[i].second, grid,
+                                     configurations.size());
+      } catch (const std::exception& ex) {
+        throw std::runtime_error(name + ": " + ex.what());
+      }
+    });
+  } catch (const std::exception& ex) {
+    throw std::runtime_error(std::string("Sweep(...): cannot dehaze image:\n") +
+                             ex.what());
+  }
+  std::vector<metrics::Scores> sums(configurations.size());
+  for (const auto& scores : image_scores)
+    for (size_t c = 0; c < sums.size(); ++c) {
+      sums[c].mse += scores[c].mse;
+      sums[c].psnr += scores[c].psnr;
+      sums[c].ssim += scores[c].ssim;
+    }
+
+  std::vector<ConfigurationScores> result;
+  double n = static_cast<double>(pairs.size());
+  for (size_t c = 0; c < configurations.size(); ++c) {
+    ConfigurationScores scores;
+    scores.parameters = configurations[c];
+    scores.mean.mse = sums[c].mse / n;
+    scores.mean.psnr = sums[c].psnr / n;
+    scores.mean.ssim = sums[c].ssim / n;
+    result.push_back(scores);
+  }
+  return result;
+}
+
+}  // namespace sweep
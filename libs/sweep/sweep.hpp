@@ -0,0 +1,50 @@
+#pragma once
+#ifndef SWEEP_HPP
+#define SWEEP_HPP
+
+#include <executor/executor.hpp>
+#include <functional>
+#include <metrics/metrics.hpp>
+#include <opencv2/core/mat.hpp>
+#include <string>
+#include <vector>
+
+namespace sweep {
+
+struct Grid {
+  std::vector<int> patch_sizes{15};
+  std::vector<double> brightest_shares{1e-3};
+  std::vector<double> omegas{0.95};
+  std::vector<int> matting_patch_sizes{51};
+  std::vector<double> t0s{0.1};
+};
+
+// All combinations of the grid; the first axis varies slowest, so
+// configurations sharing a prefix share the stages computed from it.
+std::vector<exec::DehazeParameters> Configurations(const Grid& grid);
+
+using Consumer =
+    std::function<void(const size_t configuration, const cv::Mat& result)>;
+
+// Dehazes the image with every configuration, in Configurations order. Each
+// stage is computed once per distinct prefix of the parameters it depends on:
+// the channel minimum once, the dark channel per patch size, the atmospheric
+// light per brightest share, the transmission per omega and so on. The image
+// is CV_8UC3 or CV_64FC3 with values in [0, 1]; results have the same type.
+void SweepImage(const cv::Mat& image, const Grid& grid,
+                const Consumer& consume);
+
+struct ConfigurationScores {
+  exec::DehazeParameters parameters;
+  metrics::Scores mean;
+};
+
+// Decodes every image of input_path once as CV_8UC3 and scores the 8-bit
+// results of all configurations against the image of the same name from
+// ground_truth_path.
+std::vector<ConfigurationScores> Sweep(const std::string& input_path,
+                                       const std::string& ground_truth_path,
+                                       const Grid& grid, const int jobs = 1);
+
+}  // namespace sweep
+#endif  // SWEEP_HPP
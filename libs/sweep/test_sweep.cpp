@@ -0,0 +1,58 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <doctest.h>
+
+#include <opencv2/core.hpp>
+#include <stdexcept>
+
+#include "sweep.hpp"
+
+TEST_CASE("Configurations") {
+  sweep::Grid grid;
+  grid.patch_sizes = {7, 15};
+  grid.omegas = {0.8, 0.9, 0.95};
+  auto configurations = sweep::Configurations(grid);
+  REQUIRE_EQ(configurations.size(), 6);
+  CHECK_EQ(configurations[0].patch_size, 7);
+  CHECK_EQ(configurations[2].omega, 0.95);
+  CHECK_EQ(configurations[3].patch_size, 15);
+  grid.t0s.clear();
+  REQUIRE_THROWS_WITH_AS(sweep::Configurations(grid),
+                         "Sweep(...): grid has an empty axis",
+                         const std::invalid_argument&);
+}
+
+TEST_CASE("SweepImage") {
+  cv::Mat image(48, 64, CV_64FC3);
+  cv::RNG rng(42);
+  rng.fill(image, cv::RNG::UNIFORM, 0.0, 1.0);
+  sweep::Grid grid;
+  grid.patch_sizes = {3, 7};
+  grid.brightest_shares = {1e-3, 1e-2};
+  grid.omegas = {0.9, 0.95};
+  grid.matting_patch_sizes = {5, 9};
+  grid.t0s = {0.1, 0.3};
+  auto configurations = sweep::Configurations(grid);
+  size_t calls = 0;
+  // memoized stages give exactly the results of independent runs
+  sweep::SweepImage(image, grid, [&](const size_t c, const cv::Mat& result) {
+    ++calls;
+    exec::Executor ex({image}, exec::DEHAZING, configurations[c]);
+    cv::Mat expected = ex.Process().back();
+    CHECK_EQ(cv::norm(result, expected, cv::NORM_INF), 0.0);
+  });
+  CHECK_EQ(calls, configurations.size());
+}
+
+TEST_CASE("8-bit SweepImage") {
+  cv::Mat image(48, 64, CV_8UC3);
+  cv::randu(image, cv::Scalar::all(0), cv::Scalar::all(256));
+  sweep::Grid grid;
+  grid.patch_sizes = {3};
+  grid.t0s = {0.1, 0.3};
+  auto configurations = sweep::Configurations(grid);
+  sweep::SweepImage(image, grid, [&](const size_t c, const cv::Mat& result) {
+    REQUIRE_EQ(result.type(), CV_8UC3);
+    exec::Executor ex({image}, exec::DEHAZING, configurations[c]);
+    CHECK_EQ(cv::norm(result, ex.Process().back(), cv::NORM_INF), 0.0);
+  });
+}
@@ -0,0 +1,39 @@
+#pragma once
+#ifndef TESTING_HPP
+#define TESTING_HPP
+
+#include <executor/executor.hpp>
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+#include <vector>
+
+// Fixtures shared by the tests of the libraries that dehaze as
+// exec::Executor does, header-only.
+namespace testing {
+
+// random smooth CV_8UC3 image, so dark channels and lights vary over it
+inline cv::Mat HazyImage(const cv::Size& size) {
+  cv::Mat image(size, CV_8UC3);
+  cv::randu(image, cv::Scalar::all(0), cv::Scalar::all(256));
+  cv::GaussianBlur(image, image, cv::Size(5, 5), 0);
+  return image;
+}
+
+inline std::vector<cv::Mat> HazyImages(const int count,
+                                       const cv::Size& size) {
+  std::vector<cv::Mat> images;
+  for (int n = 0; n < count; ++n) images.push_back(HazyImage(size));
+  return images;
+}
+
+// parameters scaled down to the sizes of the test images
+inline exec::DehazeParameters SmallParameters() {
+  exec::DehazeParameters parameters;
+  parameters.patch_size = 5;
+  parameters.matting_patch_size = 9;
+  parameters.brightest_share = 0.01;
+  return parameters;
+}
+
+}  // namespace testing
+#endif  // TESTING_HPP
@@ -0,0 +1,54 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <doctest.h>
+
+#include <string>
+#include <thread>
+#include <trace.hpp>
+
+static size_t Count(const std::string& str, const std::string& pattern) {
+  size_t count = 0;
+  for (size_t pos = str.find(pattern); pos != std::string::npos;
+       pos = str.find(pattern, pos + 1))
+    ++count;
+  return count;
+}
+
+TEST_CASE("disabled") {
+  trace::Start();
+  trace::Stop();
+  { trace::Span span("disabled"); }
+  CHECK_EQ(Count(trace::ToJson(), "\"ph\": \"X\""), 0);
+}
+
+TEST_CASE("spans per thread") {
+  REQUIRE_THROWS_WITH_AS(trace::Start(0),
+                         "Start(...): ring buffer can't be empty",
+                         const std::invalid_argument&);
+  trace::Start();
+  auto work = [](const std::string& image) {
+    trace::SetThreadName("worker " + image);
+    trace::SetDetail(image);
+    trace::Span outer("image");
+    { trace::Span inner("dark_channel"); }
+  };
+  std::thread first(work, "a.png");
+  std::thread second(work, "b\"c.png");
+  first.join();
+  second.join();
+  trace::Stop();
+  std::string json = trace::ToJson();
+  CHECK_EQ(Count(json, "\"ph\": \"X\""), 4);
+  CHECK_EQ(Count(json, "\"ph\": \"M\""), 2);
+  CHECK_EQ(Count(json, "\"name\": \"dark_channel\""), 2);
+  CHECK_EQ(Count(json, "\"detail\": \"a.png\""), 2);
+  CHECK_EQ(Count(json, "\"detail\": \"b\\\"c.png\""), 2);
+  CHECK_NE(json.find("\"tid\": 1"), std::string::npos);
+  CHECK_NE(json.find("\"tid\": 2"), std::string::npos);
+}
+
+TEST_CASE("ring buffer keeps the latest events") {
+  trace::Start(4);
+  for (int i = 0; i < 10; ++i) trace::Span span("event");
+  trace::Stop();
+  CHECK_EQ(Count(trace::ToJson(), "\"name\": \"event\""), 4);
+}
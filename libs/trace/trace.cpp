@@ -0,0 +1,176 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <trace.hpp>
+#include <vector>
+
+namespace trace {
+
+namespace {
+
+const size_t detail_size = 64;
+
+struct Event {
+  const char* name = nullptr;
+  char detail[detail_size] = {};
+  int64_t start_us = 0;
+  int64_t duration_us = 0;
+};
+
+// Single-producer ring: only the owning thread writes events and publishes
+// them by bumping the counter, so spans never take a lock.
+struct ThreadBuffer {
+  ThreadBuffer(const size_t capacity, const int tid)
+      : events(capacity), tid(tid) {}
+  std::vector<Event> events;
+  std::atomic<size_t> written{0};
+  const int tid;
+  char name[detail_size] = {};
+};
+
+std::atomic<bool> enabled{false};
+std::atomic<uint64_t> generation{0};
+std::mutex buffers_mutex;
+std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+size_t capacity = 1 << 16;
+std::chrono::steady_clock::time_point origin;
+
+thread_local ThreadBuffer* thread_buffer = nullptr;
+thread_local uint64_t thread_generation = 0;
+thread_local char thread_detail[detail_size] = {};
+
+ThreadBuffer* CurrentBuffer() {
+  uint64_t current = generation.load(std::memory_order_acquire);
+  if (thread_buffer == nullptr || thread_generation != current) {
+    std::lock_guard<std::mutex> lock(buffers_mutex);
+    buffers.push_back(std::make_unique<ThreadBuffer>(
+        capacity, static_cast<int>(buffers.size()) + 1));
+    thread_buffer = buffers.back().get();
+    thread_generation = current;
+  }
+  return thread_buffer;
+}
+
+int64_t NowUs() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now() - origin)
+      .count();
+}
+
+void CopyTruncated(char* dst, const std::string& src) {
+  size_t size = std::min(src.size(), detail_size - 1);
+  std::memcpy(dst, src.data(), size);
+  dst[size] = '\0';
+}
+
+std::string Escape(const char* str) {
+  std::string result;
+  for (; *str != '\0'; ++str) {
+    unsigned char c = static_cast<unsigned char>(*str);
+    if (c == '"' || c == '\\') {
+      result += '\\';
+      result += static_cast<char>(c);
+    } else if (c < 0x20) {
+      char code[7];
+      std::snprintf(code, sizeof(code), "\\u%04x", c);
+      result += code;
+    } else {
+      result += static_cast<char>(c);
+    }
+  }
+  return result;
+}
+
+}  // namespace
+
+void Start(const size_t events_per_thread) {
+  if (events_per_thread == 0)
+    throw std::invalid_argument("Start(...): ring buffer can't be empty");
+  std::lock_guard<std::mutex> lock(buffers_mutex);
+  buffers.clear();
+  capacity = events_per_thread;
+  origin = std::chrono::steady_clock::now();
+  generation.fetch_add(1, std::memory_order_release);
+  enabled.store(true, std::memory_order_release);
+}
+
+void Stop() { enabled.store(false, std::memory_order_release); }
+
+bool Enabled() { return enabled.load(std::memory_order_relaxed); }
+
+void SetDetail(const std::string& detail) {
+  CopyTruncated(thread_detail, detail);
+}
+
+void SetThreadName(const std::string& name) {
+  if (!Enabled()) return;
+  CopyTruncated(CurrentBuffer()->name, name);
+}
+
+std::string ToJson() {
+  std::lock_guard<std::mutex> lock(buffers_mutex);
+  std::ostringstream json;
+  json << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [";
+  bool first = true;
+  auto separator = [&]() {
+    json << (first ? "\n" : ",\n");
+    first = false;
+  };
+  for (const auto& buffer : buffers) {
+    std::string name = buffer->name[0] != '\0'
+                           ? Escape(buffer->name)
+                           : "thread " + std::to_string(buffer->tid);
+    separator();
+    json << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, "
+         << "\"tid\": " << buffer->tid << ", \"args\": {\"name\": \"" << name
+         << "\"}}";
+    size_t written = buffer->written.load(std::memory_order_acquire);
+    size_t size = buffer->events.size();
+    for (size_t i = written > size ? written - size : 0; i < written; ++i) {
+      const Event& event = buffer->events[i % size];
+      separator();
+      json << "{\"name\": \"" << Escape(event.name)
+           << "\", \"cat\": \"dcp\", \"ph\": \"X\", \"ts\": " << event.start_us
+           << ", \"dur\": " << event.duration_us
+           << ", \"pid\": 1, \"tid\": " << buffer->tid;
+      if (event.detail[0] != '\0')
+        json << ", \"args\": {\"detail\": \"" << Escape(event.detail)
+             << "\"}";
+      json << "}";
+    }
+  }
+  json << "\n]}\n";
+  return json.str();
+}
+
+void Write(const std::string& path) {
+  std::ofstream file(path);
+  if (!file) throw std::runtime_error("Write(...): cannot open file");
+  file << ToJson();
+}
+
+Span::Span(const char* name) : name(name), active(Enabled()) {
+  if (active) start_us = NowUs();
+}
+
+Span::~Span() {
+  if (!active) return;
+  int64_t finish_us = NowUs();
+  ThreadBuffer* buffer = CurrentBuffer();
+  size_t index = buffer->written.load(std::memory_order_relaxed);
+  Event& event = buffer->events[index % buffer->events.size()];
+  event.name = name;
+  std::memcpy(event.detail, thread_detail, detail_size);
+  event.start_us = start_us;
+  event.duration_us = finish_us - start_us;
+  buffer->written.store(index + 1, std::memory_order_release);
+}
+
+}  // namespace trace
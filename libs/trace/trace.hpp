@@ -0,0 +1,46 @@
+#pragma once
+#ifndef TRACE_HPP
+#define TRACE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace trace {
+
+// Start and Stop must not race with open spans: they are meant to be called
+// before the workers are launched and after they are joined.
+void Start(const size_t events_per_thread = 1 << 16);
+
+void Stop();
+
+bool Enabled();
+
+// Attaches a short description (e.g. the image name) to the following spans of
+// the calling thread.
+void SetDetail(const std::string& detail);
+
+void SetThreadName(const std::string& name);
+
+std::string ToJson();
+
+void Write(const std::string& path);
+
+class Span {
+ public:
+  Span() = delete;
+  Span(const Span&) = delete;
+  Span(Span&&) = delete;
+  Span& operator=(const Span&) = delete;
+  Span& operator=(Span&&) = delete;
+  explicit Span(const char* name);
+  ~Span();
+
+ private:
+  const char* name;
+  bool active;
+  int64_t start_us = 0;
+};
+
+}  // namespace trace
+#endif  // TRACE_HPP
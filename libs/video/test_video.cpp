@@ -0,0 +1,60 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <doctest.h>
+
+#include <dcp.hpp>
+#include <opencv2/core.hpp>
+#include <video.hpp>
+
+static double MaxDifference(const cv::Mat& lhs, const cv::Mat& rhs) {
+  return cv::norm(lhs, rhs, cv::NORM_INF);
+}
+
+TEST_CASE("IncrementalDehazer") {
+  cv::Size size(128, 96);
+  REQUIRE_THROWS_WITH_AS(
+      [&]() { video::IncrementalDehazer dehazer(size, 32, 0.02, 6); }(),
+      "IncrementalDehazer::IncrementalDehazer(...): patch size can't be even",
+      const std::invalid_argument&);
+  video::IncrementalDehazer dehazer(size, 32, 0.02, 7, 11);
+
+  cv::Mat frame(size, CV_64FC3);
+  cv::randu(frame, cv::Scalar::all(0.2), cv::Scalar::all(0.8));
+  cv::Mat result;
+  REQUIRE_THROWS_WITH_AS(dehazer.Process(result, cv::Mat(10, 10, CV_64FC3)),
+                         "IncrementalDehazer::Process(...): incorrect size of "
+                         "frame",
+                         const std::invalid_argument&);
+  REQUIRE_NOTHROW(dehazer.Process(result, frame));
+  CHECK_EQ(dehazer.DirtyShare(), 1.0);
+  CHECK_EQ(result.size(), size);
+  CHECK_EQ(result.type(), CV_64FC3);
+  cv::Mat first_transmission = dehazer.RefinedTransmission().clone();
+
+  SUBCASE("static frame") {
+    cv::Mat static_result;
+    dehazer.Process(static_result, frame);
+    CHECK_EQ(dehazer.DirtyShare(), 0.0);
+    CHECK_EQ(MaxDifference(first_transmission, dehazer.RefinedTransmission()),
+             0.0);
+    CHECK_EQ(MaxDifference(result, static_result), 0.0);
+  }
+
+  SUBCASE("changed tile") {
+    cv::Mat changed = frame.clone();
+    // the block lies at the tile border, so the neighbouring tile is affected
+    changed(cv::Rect(58, 40, 6, 8)).setTo(cv::Scalar(0.9, 0.1, 0.5));
+    cv::Mat changed_result;
+    dehazer.Process(changed_result, changed);
+    CHECK_GT(dehazer.DirtyShare(), 0.0);
+    CHECK_LT(dehazer.DirtyShare(), 0.5);
+
+    const cv::Mat& atmospheric_light = dehazer.AtmosphericLight();
+    cv::Mat dark_channel = dcp::DarkChannel(changed, 7);
+    cv::Mat transmission =
+        dcp::EstimateTransmission(changed, atmospheric_light, 7);
+    cv::Mat refined = dcp::SoftMatting(transmission, changed, 11, 0.01);
+    CHECK_LT(MaxDifference(dark_channel, dehazer.DarkChannel()), 1e-12);
+    CHECK_LT(MaxDifference(transmission, dehazer.Transmission()), 1e-12);
+    CHECK_LT(MaxDifference(refined, dehazer.RefinedTransmission()), 1e-9);
+  }
+}
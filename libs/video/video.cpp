@@ -0,0 +1,142 @@
+#include <algorithm>
+#include <dcp.hpp>
+#include <haze_model.hpp>
+#include <opencv2/core.hpp>
+#include <stdexcept>
+#include <video.hpp>
+
+namespace video {
+
+IncrementalDehazer::IncrementalDehazer(const cv::Size& frame_size,
+                                       const int tile_size,
+                                       const double change_threshold,
+                                       const int patch_size,
+                                       const int matting_patch_size,
+                                       const int atmospheric_light_period)
+    : frame_size(frame_size),
+      tile_size(tile_size),
+      change_threshold(change_threshold),
+      patch_size(patch_size),
+      matting_patch_size(matting_patch_size),
+      atmospheric_light_period(atmospheric_light_period) {
+  if (frame_size.width <= 0 || frame_size.height <= 0)
+    throw std::invalid_argument(
+        "IncrementalDehazer::IncrementalDehazer(...): incorrect frame size");
+  if (tile_size <= 0)
+    throw std::invalid_argument(
+        "IncrementalDehazer::IncrementalDehazer(...): incorrect tile size");
+  if (patch_size % 2 == 0 || matting_patch_size % 2 == 0)
+    throw std::invalid_argument(
+        "IncrementalDehazer::IncrementalDehazer(...): patch size can't be "
+        "even");
+  if (change_threshold < 0 || atmospheric_light_period < 0)
+    throw std::invalid_argument(
+        "IncrementalDehazer::IncrementalDehazer(...): parameters are out of "
+        "range");
+}
+
+void IncrementalDehazer::Reset() {
+  reference_frame.release();
+  dark_channel.release();
+  transmission.release();
+  refined_transmission.release();
+  atmospheric_light.release();
+  frames_since_light_update = 0;
+  dirty_share = 1.0;
+}
+
+void IncrementalDehazer::Process(cv::Mat& result, const cv::Mat& frame) {
+  if (frame.type() != CV_64FC3)
+    throw std::invalid_argument(
+        "IncrementalDehazer::Process(...): incorrect type of frame");
+  if (frame.size() != frame_size)
+    throw std::invalid_argument(
+        "IncrementalDehazer::Process(...): incorrect size of frame");
+  bool light_is_outdated = atmospheric_light_period > 0 &&
+                           frames_since_light_update >= atmospheric_light_period;
+  if (reference_frame.empty() || light_is_outdated) {
+    ProcessFull(frame);
+  } else {
+    for (const cv::Rect& rect : DirtyRects(frame)) UpdateRect(rect, frame);
+    ++frames_since_light_update;
+  }
+  haze::HazeModel model(refined_transmission, atmospheric_light);
+  result.create(frame_size, CV_64FC3);
+  model.RecoverImage(result, frame);
+}
+
+void IncrementalDehazer::ProcessFull(const cv::Mat& frame) {
+  dark_channel = dcp::DarkChannel(frame, patch_size);
+  atmospheric_light = dcp::EstimateAtmospericLight(frame, patch_size);
+  transmission =
+      dcp::EstimateTransmission(frame, atmospheric_light, patch_size);
+  refined_transmission =
+      dcp::SoftMatting(transmission, frame, matting_patch_size, 0.01);
+  reference_frame = frame.clone();
+  frames_since_light_update = 0;
+  dirty_share = 1.0;
+}
+
+std::vector<cv::Rect> IncrementalDehazer::DirtyRects(const cv::Mat& frame) {
+  // A tile is dirty when some pixel drifted from the frame its cached results
+  // were computed on; horizontally adjacent dirty tiles are merged into runs so
+  // that their halos are computed once.
+  cv::Mat diff;
+  cv::absdiff(frame, reference_frame, diff);
+  std::vector<cv::Rect> rects;
+  int tiles_num = 0;
+  int dirty_num = 0;
+  for (int y = 0; y < frame_size.height; y += tile_size) {
+    int height = std::min(tile_size, frame_size.height - y);
+    cv::Rect run;
+    for (int x = 0; x < frame_size.width; x += tile_size) {
+      cv::Rect tile(x, y, std::min(tile_size, frame_size.width - x), height);
+      ++tiles_num;
+      if (cv::norm(diff(tile), cv::NORM_INF) > change_threshold) {
+        ++dirty_num;
+        run = run.empty() ? tile : (run | tile);
+        frame(tile).copyTo(reference_frame(tile));
+      } else if (!run.empty()) {
+        rects.push_back(run);
+        run = cv::Rect();
+      }
+    }
+    if (!run.empty()) rects.push_back(run);
+  }
+  dirty_share = static_cast<double>(dirty_num) / tiles_num;
+  return rects;
+}
+
+void IncrementalDehazer::UpdateRect(const cv::Rect& rect,
+                                    const cv::Mat& frame) {
+  // pixels whose patch touches the changed rect get a new dark channel
+  cv::Rect dc_rect = Expand(rect, patch_size / 2);
+  cv::Rect dc_source_rect = Expand(dc_rect, patch_size / 2);
+  cv::Rect dc_inner(dc_rect.x - dc_source_rect.x, dc_rect.y - dc_source_rect.y,
+                    dc_rect.width, dc_rect.height);
+  cv::Mat frame_roi = frame(dc_source_rect);
+  dcp::DarkChannel(frame_roi, patch_size)(dc_inner)
+      .copyTo(dark_channel(dc_rect));
+  dcp::EstimateTransmission(frame_roi, atmospheric_light, patch_size)(dc_inner)
+      .copyTo(transmission(dc_rect));
+
+  // the same holds for the box filter window of the refinement
+  cv::Rect refined_rect = Expand(dc_rect, matting_patch_size / 2);
+  cv::Rect refined_source_rect = Expand(refined_rect, matting_patch_size / 2);
+  cv::Rect refined_inner(refined_rect.x - refined_source_rect.x,
+                         refined_rect.y - refined_source_rect.y,
+                         refined_rect.width, refined_rect.height);
+  dcp::SoftMatting(transmission(refined_source_rect),
+                   frame(refined_source_rect), matting_patch_size,
+                   0.01)(refined_inner)
+      .copyTo(refined_transmission(refined_rect));
+}
+
+cv::Rect IncrementalDehazer::Expand(const cv::Rect& rect,
+                                    const int halo) const {
+  cv::Rect expanded(rect.x - halo, rect.y - halo, rect.width + 2 * halo,
+                    rect.height + 2 * halo);
+  return expanded & cv::Rect(cv::Point(0, 0), frame_size);
+}
+
+}  // namespace video
@@ -0,0 +1,53 @@
+#pragma once
+#ifndef VIDEO_HPP
+#define VIDEO_HPP
+
+#include <opencv2/core/mat.hpp>
+#include <vector>
+
+namespace video {
+
+class IncrementalDehazer {
+ public:
+  IncrementalDehazer() = delete;
+  IncrementalDehazer(const IncrementalDehazer&) = delete;
+  IncrementalDehazer(IncrementalDehazer&&) = delete;
+  IncrementalDehazer& operator=(const IncrementalDehazer&) = delete;
+  IncrementalDehazer& operator=(IncrementalDehazer&&) = delete;
+  IncrementalDehazer(const cv::Size& frame_size, const int tile_size = 64,
+                     const double change_threshold = 0.02,
+                     const int patch_size = 15,
+                     const int matting_patch_size = 51,
+                     const int atmospheric_light_period = 0);
+  void Process(cv::Mat& result, const cv::Mat& frame);
+  void Reset();
+  const cv::Mat& DarkChannel() const { return dark_channel; }
+  const cv::Mat& Transmission() const { return transmission; }
+  const cv::Mat& RefinedTransmission() const { return refined_transmission; }
+  const cv::Mat& AtmosphericLight() const { return atmospheric_light; }
+  double DirtyShare() const { return dirty_share; }
+  ~IncrementalDehazer() = default;
+
+ private:
+  void ProcessFull(const cv::Mat& frame);
+  std::vector<cv::Rect> DirtyRects(const cv::Mat& frame);
+  void UpdateRect(const cv::Rect& rect, const cv::Mat& frame);
+  cv::Rect Expand(const cv::Rect& rect, const int halo) const;
+
+  const cv::Size frame_size;
+  const int tile_size;
+  const double change_threshold;
+  const int patch_size;
+  const int matting_patch_size;
+  const int atmospheric_light_period;
+  int frames_since_light_update = 0;
+  double dirty_share = 1.0;
+  cv::Mat reference_frame;
+  cv::Mat dark_channel;
+  cv::Mat transmission;
+  cv::Mat refined_transmission;
+  cv::Mat atmospheric_light;
+};
+
+}  // namespace video
+#endif  // VIDEO_HPP